@@ -39,14 +39,14 @@
 //   <i> Defines max. number of user threads that will run at the same time.
 //   <i> Default: 6
 #ifndef OS_TASKCNT
- #define OS_TASKCNT     6
+ #define OS_TASKCNT     3       // main, uart_handler and waveform threads, main takes a slot too
 #endif
  
 //   <o>Default Thread stack size [bytes] <64-4096:8><#/4>
 //   <i> Defines default stack size for threads with osThreadDef stacksz = 0
 //   <i> Default: 200
 #ifndef OS_STKSIZE
- #define OS_STKSIZE     50      // this stack size value is in words
+ #define OS_STKSIZE     64      // this stack size value is in words
 #endif
  
 //   <o>Main Thread stack size [bytes] <64-32768:8><#/4>
@@ -60,14 +60,14 @@
 //   <i> Defines the number of threads with user-provided stack size.
 //   <i> Default: 0
 #ifndef OS_PRIVCNT
- #define OS_PRIVCNT     0
+ #define OS_PRIVCNT     2       // the uart_handler and waveform threads
 #endif
  
 //   <o>Total stack size [bytes] for threads with user-provided stack size <0-1048576:8><#/4>
 //   <i> Defines the combined stack size for threads with user-provided stack size.
 //   <i> Default: 0
 #ifndef OS_PRIVSTKSIZE
- #define OS_PRIVSTKSIZE 0       // this stack size value is in words
+ #define OS_PRIVSTKSIZE 320     // this stack size value is in words, UART_ and WAVEFORM_THREAD_STACK_BYTES in main.c
 #endif
  
 //   <q>Stack overflow checking
@@ -81,7 +81,7 @@
 //   <i> Initialize thread stack with watermark pattern for analyzing stack usage (current/maximum) in System and Thread Viewer.
 //   <i> Enabling this option increases significantly the execution time of osThreadCreate.
 #ifndef OS_STKINIT
-#define OS_STKINIT      0
+#define OS_STKINIT      1
 #endif
  
 //   <o>Processor mode for thread execution 
@@ -145,7 +145,7 @@
 // ==============
 //   <i> Enables user Timers
 #ifndef OS_TIMERS
- #define OS_TIMERS      1
+ #define OS_TIMERS      0
 #endif
  
 //   <o>Timer Thread Priority
@@ -212,11 +212,32 @@
  
 /*--------------------------- os_idle_demon ---------------------------------*/
 
+// tickless.c times its sleeps in ticks of its own length, which has to be this one
+#include "../../tickless.h"
+#if (OS_TICK != TICKLESS_TICK_US)
+ #error "OS_TICK has to match TICKLESS_TICK_US in tickless.h"
+#endif
+
+#if (OS_TIMERS != 0)
+// sleeps until an interrupt, counting the idle time for the CPU load meter, cpu_load.c
+extern void cpu_load_idle (void);
+#else
+// RTX scheduler suspend/resume for tickless idle
+extern uint32_t os_suspend (void);
+extern void os_resume (uint32_t sleep_time);
+#endif
+
 /// \brief The idle demon is running when no other thread is ready to run
 void os_idle_demon (void) {
  
   for (;;) {
-    __asm volatile("wfe");
+#if (OS_TIMERS != 0)
+    // the timer thread isn't covered by what tickless.c was written against, keep the tick running
+    cpu_load_idle();
+#else
+    // stop the tick and sleep until the next timeout or interrupt, then catch RTX up
+    os_resume(tickless_sleep(os_suspend()));
+#endif
   }
 }
  
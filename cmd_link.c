@@ -0,0 +1,429 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "cmd_link.h"
+#include "global.h"
+#include "metrics.h"
+#include "trace.h"
+#include "uart_rx.h"
+#include "uart_tx.h"
+#include "waveform.h"
+#include "waveform_cfg.h"
+
+// COBS adds a code byte for every 254 bytes and one to start
+#define MAX_ENCODED		(CMD_LINK_MAX_FRAME + CMD_LINK_MAX_FRAME / 254 + 1)
+// sequence number and opcode before the payload, CRC after it
+#define HEADER_LEN		2
+#define CRC_LEN			4
+// room for a reply's payload after its status byte
+#define REPLY_CAP		(CMD_LINK_MAX_FRAME - HEADER_LEN - 1 - CRC_LEN)
+// trace records that fit in a reply after the record count and first index
+#define TRACE_CHUNK		((REPLY_CAP - 4) / 8)
+
+// received frame up to its delimiter, decoded in place
+static uint8_t rxFrame[MAX_ENCODED];
+// reply being built, before it's encoded
+static uint8_t reply[CMD_LINK_MAX_FRAME];
+// last reply as sent, with its delimiters, kept to answer a retry
+static uint8_t txFrame[MAX_ENCODED + 2];
+static uint16_t txLen = 0;
+// sequence number of the last command run, -1 if none since the link opened
+static int16_t lastSeq = -1;
+// non-zero while the trace is paused for a read that hasn't reached its last record
+static uint8_t bTraceReading = 0;
+
+void cmd_link_init(void)
+{
+	// enable the CRC unit clock
+	RCC->AHBENR |= RCC_AHBENR_CRCEN;
+}
+
+/** Reads a little-endian u16. */
+static inline uint16_t get_u16(uint8_t const *data)
+{
+	return data[0] | (data[1] << 8);
+}
+
+/** Reads a little-endian u32. */
+static inline uint32_t get_u32(uint8_t const *data)
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/** Writes a little-endian u16, returns the next byte. */
+static inline uint8_t *put_u16(uint8_t *data, uint16_t value)
+{
+	data[0] = value;
+	data[1] = value >> 8;
+	return data + 2;
+}
+
+/** Writes a little-endian u32, returns the next byte. */
+static inline uint8_t *put_u32(uint8_t *data, uint32_t value)
+{
+	data[0] = value;
+	data[1] = value >> 8;
+	data[2] = value >> 16;
+	data[3] = value >> 24;
+	return data + 4;
+}
+
+#ifdef CMD_LINK_HOST
+// the CRC the CRC unit calculates, in software for host builds without one
+static uint32_t hostCrc;
+
+static inline void crc_reset(void)
+{
+	hostCrc = 0xFFFFFFFF;
+}
+
+static inline void crc_feed(uint32_t word)
+{
+	hostCrc ^= word;
+	for (uint8_t i = 0; i < 32; ++i) {
+		hostCrc = (hostCrc & 0x80000000) ? (hostCrc << 1) ^ 0x04C11DB7 : hostCrc << 1;
+	}
+}
+
+static inline uint32_t crc_value(void)
+{
+	return hostCrc;
+}
+#else
+static inline void crc_reset(void)
+{
+	CRC->CR = CRC_CR_RESET;
+}
+
+static inline void crc_feed(uint32_t word)
+{
+	CRC->DR = word;
+}
+
+static inline uint32_t crc_value(void)
+{
+	return CRC->DR;
+}
+#endif
+
+/** Calculates the CRC of len bytes with the CRC unit, fed as little-endian words padded with zeros. */
+static uint32_t crc32(uint8_t const *data, uint16_t len)
+{
+	crc_reset();
+	for (uint16_t i = 0; i < len; i += 4) {
+		uint32_t word = 0;
+		for (uint8_t j = 0; j < 4 && i + j < len; ++j) {
+			word |= (uint32_t)data[i + j] << (8 * j);
+		}
+		crc_feed(word);
+	}
+	return crc_value();
+}
+
+/** COBS encodes len bytes into dst, which has room for MAX_ENCODED. Returns the encoded length. */
+static uint16_t cobs_encode(uint8_t const *src, uint16_t len, uint8_t *dst)
+{
+	// each code byte holds the distance to the next zero, or 0xFF for 254 bytes without one
+	uint16_t code = 0;
+	uint16_t out = 1;
+	uint8_t run = 1;
+	for (uint16_t i = 0; i < len; ++i) {
+		if (src[i] == 0) {
+			dst[code] = run;
+			code = out++;
+			run = 1;
+			continue;
+		}
+		dst[out++] = src[i];
+		if (++run == 0xFF) {
+			dst[code] = run;
+			code = out++;
+			run = 1;
+		}
+	}
+	dst[code] = run;
+	return out;
+}
+
+/** COBS decodes len bytes in place. Returns the decoded length, or -1 if the encoding is invalid. */
+static int32_t cobs_decode(uint8_t *data, uint16_t len)
+{
+	// the output never catches up with the input, one code byte is dropped per block
+	uint16_t in = 0;
+	uint16_t out = 0;
+	while (in < len) {
+		uint8_t const code = data[in++];
+		if (code == 0 || in + code - 1 > len) {
+			return -1;
+		}
+		for (uint8_t i = 1; i < code; ++i) {
+			data[out++] = data[in++];
+		}
+		// every block but a full one and the last ends in a zero
+		if (code != 0xFF && in < len) {
+			data[out++] = 0;
+		}
+	}
+	return out;
+}
+
+/** Returns non-zero if the waveform has the param and the value is in the range the menus accept. */
+static uint8_t param_valid(waveform_id_t wave, uint8_t param, uint32_t value)
+{
+	switch (param) {
+		case PARAM_AMPLITUDE:
+			return value <= 100;
+		case PARAM_FREQ_MHZ:
+			return value <= 50000000;
+		case PARAM_DUTYCYCLE:
+			return wave == WAVEFORM_PWM && value <= 100;
+		case PARAM_SAMPLE_RATE:
+			// the rates the sample rate menu offers
+			return wave != WAVEFORM_PWM
+				&& (value == 1000 || value == 10000 || value == 50000 || value == 100000);
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Runs a command, filling its reply payload into out, which has room for REPLY_CAP bytes.
+ * Returns the status of the command.
+ */
+static cmd_link_status_t run_cmd(uint8_t op, uint8_t const *args, uint16_t argsLen,
+	uint8_t *out, uint16_t *outLen)
+{
+	*outLen = 0;
+
+	switch (op) {
+		case CMD_LINK_PING:
+		case CMD_LINK_CLOSE:
+		{
+			if (argsLen != 0) {
+				return CMD_LINK_ERR_LEN;
+			}
+			if (op == CMD_LINK_PING) {
+				// the clock rate lets the host turn trace timestamps into time
+				out[0] = CMD_LINK_VERSION;
+				put_u32(&out[1], SystemCoreClock);
+				*outLen = 5;
+			}
+			return CMD_LINK_OK;
+		}
+		case CMD_LINK_SET:
+		{
+			// the waveform, then 5 bytes for each param
+			if (argsLen < 1 || (argsLen - 1) % 5 != 0) {
+				return CMD_LINK_ERR_LEN;
+			}
+			waveform_id_t const wave = args[0];
+			if (wave >= WAVEFORM_NUM) {
+				return CMD_LINK_ERR_ARG;
+			}
+			// check every param before sending any, so a bad one doesn't apply half the command
+			waveform_batch_t batch = {0};
+			for (uint16_t i = 1; i < argsLen; i += 5) {
+				waveform_cfg_t const cfg = {
+					.type = args[i],
+					.value = get_u32(&args[i + 1]),
+				};
+				if (!param_valid(wave, cfg.type, cfg.value)) {
+					return CMD_LINK_ERR_ARG;
+				}
+				waveform_batch_add(&batch, cfg);
+			}
+			if (batch.mask != 0 && waveform_send_batch(wave, &batch) != osOK) {
+				return CMD_LINK_ERR_BUSY;
+			}
+			return CMD_LINK_OK;
+		}
+		case CMD_LINK_GET:
+		{
+			if (argsLen != 1) {
+				return CMD_LINK_ERR_LEN;
+			}
+			if (args[0] >= WAVEFORM_NUM) {
+				return CMD_LINK_ERR_ARG;
+			}
+			waveform_status_t status;
+			waveform_get_status(args[0], &status);
+			out = put_u32(out, status.freqMhz);
+			out = put_u32(out, status.sampleRateHz);
+			out[0] = status.amplitude;
+			out[1] = status.dutyCycle;
+			out[2] = status.bEnabled;
+			*outLen = 11;
+			return CMD_LINK_OK;
+		}
+		case CMD_LINK_ENABLE:
+		{
+			if (argsLen != 2) {
+				return CMD_LINK_ERR_LEN;
+			}
+			waveform_id_t const wave = args[0];
+			if (wave >= WAVEFORM_NUM) {
+				return CMD_LINK_ERR_ARG;
+			}
+			// the enable param toggles, only send it if the output has to change
+			// the waveform thread runs above this one, so the status is never behind a sent param
+			waveform_status_t status;
+			waveform_get_status(wave, &status);
+			uint8_t const bEnable = (args[1] != 0);
+			if (bEnable != (status.bEnabled != 0)) {
+				waveform_cfg_t const cfg = {
+					.type = PARAM_ENABLE,
+					.value = bEnable,
+				};
+				if (waveform_send_cfg(wave, cfg) != osOK) {
+					return CMD_LINK_ERR_BUSY;
+				}
+			}
+			return CMD_LINK_OK;
+		}
+		case CMD_LINK_STATS:
+		{
+			if (argsLen != 0) {
+				return CMD_LINK_ERR_LEN;
+			}
+			uint8_t *next = out;
+			*next++ = METRIC_NUM;
+			for (metric_t metric = 0; metric < METRIC_NUM; ++metric) {
+				uint32_t value;
+				uint32_t max;
+				metrics_read(metric, &value, &max);
+				next = put_u32(next, value);
+				next = put_u32(next, max);
+			}
+			*outLen = next - out;
+			return CMD_LINK_OK;
+		}
+		case CMD_LINK_TRACE:
+		{
+			if (argsLen != 2) {
+				return CMD_LINK_ERR_LEN;
+			}
+			// this is the UART thread, the lowest priority thread that records, so the buffer is settled
+			// pausing again while a read is in progress keeps it as it is
+			uint16_t const count = trace_pause();
+			bTraceReading = 1;
+			uint16_t const first = get_u16(args);
+			if (first > count) {
+				return CMD_LINK_ERR_ARG;
+			}
+			uint16_t const num = (count - first < TRACE_CHUNK) ? count - first : TRACE_CHUNK;
+
+			uint8_t *next = put_u16(out, count);
+			next = put_u16(next, first);
+			for (uint16_t i = first; i < first + num; ++i) {
+				trace_record_t record;
+				trace_read(i, &record);
+				next = put_u32(next, record.time);
+				*next++ = record.event;
+				*next++ = record.arg;
+				next = put_u16(next, record.data);
+			}
+			*outLen = next - out;
+
+			if (first + num == count) {
+				// all read, start over so the next read only has what happened after this one
+				trace_resume();
+				bTraceReading = 0;
+			}
+			return CMD_LINK_OK;
+		}
+		default:
+			return CMD_LINK_ERR_OP;
+	}
+}
+
+/**
+ * Checks and runs a received frame of len encoded bytes, and sends its reply.
+ * Returns non-zero if it closed the link.
+ */
+static uint8_t handle_frame(uint16_t len)
+{
+	int32_t const frameLen = cobs_decode(rxFrame, len);
+	if (frameLen < HEADER_LEN + CRC_LEN
+		|| crc32(rxFrame, frameLen - CRC_LEN) != get_u32(&rxFrame[frameLen - CRC_LEN])) {
+		// corrupted, the host retries when no reply comes
+		metrics_inc(METRIC_LINK_ERRORS);
+		return 0;
+	}
+
+	uint8_t const seq = rxFrame[0];
+	uint8_t const op = rxFrame[1];
+	trace_event(TRACE_LINK_CMD, op, seq);
+
+	if (seq != lastSeq) {
+		if (op != CMD_LINK_TRACE && bTraceReading) {
+			// the host gave up on a read, don't leave the trace paused, what it didn't read is dropped
+			trace_resume();
+			bTraceReading = 0;
+		}
+		uint16_t payloadLen;
+		reply[0] = seq;
+		reply[1] = op | CMD_LINK_REPLY;
+		reply[2] = run_cmd(op, &rxFrame[HEADER_LEN], frameLen - HEADER_LEN - CRC_LEN,
+			&reply[HEADER_LEN + 1], &payloadLen);
+		metrics_inc(METRIC_LINK_CMDS);
+
+		uint16_t const replyLen = HEADER_LEN + 1 + payloadLen;
+		put_u32(&reply[replyLen], crc32(reply, replyLen));
+
+		// a delimiter on both sides separates the reply from any menu text before it
+		txFrame[0] = CMD_LINK_DELIM;
+		txLen = 1 + cobs_encode(reply, replyLen + CRC_LEN, &txFrame[1]);
+		txFrame[txLen++] = CMD_LINK_DELIM;
+		lastSeq = seq;
+	}
+	// a repeated sequence number is a retry after a lost reply, send it again without rerunning the command
+	uart_tx_send((char const *)txFrame, txLen);
+
+	return op == CMD_LINK_CLOSE && reply[2] == CMD_LINK_OK;
+}
+
+void cmd_link_run(void)
+{
+	// characters taken from the receive ring at once
+	uint8_t chunk[32];
+	// encoded bytes of the frame so far
+	uint16_t len = 0;
+	// non-zero if the frame outgrew the buffer, it's dropped at its delimiter
+	uint8_t bOverflow = 0;
+
+	// a sequence number from before the link opened is never a retry
+	lastSeq = -1;
+
+	while (1) {
+		uint16_t n = uart_rx_read((char *)chunk, sizeof(chunk));
+		if (n == 0) {
+			// nothing waiting, sleep until something arrives
+			chunk[0] = uart_rx_getc();
+			n = 1;
+		}
+
+		for (uint16_t i = 0; i < n; ++i) {
+			if (chunk[i] != CMD_LINK_DELIM) {
+				if (len < sizeof(rxFrame)) {
+					rxFrame[len++] = chunk[i];
+				} else {
+					bOverflow = 1;
+				}
+				continue;
+			}
+
+			if (bOverflow) {
+				metrics_inc(METRIC_LINK_ERRORS);
+			} else if (len != 0 && handle_frame(len)) {
+				// the host waits for the close reply before sending anything else, so nothing is left behind
+				return;
+			}
+			len = 0;
+			bOverflow = 0;
+		}
+	}
+}
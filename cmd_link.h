@@ -0,0 +1,87 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Binary command link for scripts, alongside the menus.
+ * A 0x00 byte typed at any menu prompt opens the link. From then on the UART carries
+ * COBS encoded frames, each ended by 0x00, until a CMD_LINK_CLOSE command returns to the menus.
+ * Empty frames are ignored, so a host can put a 0x00 before every frame too.
+ *
+ * A decoded frame is: sequence number, opcode, payload, CRC32.
+ * The CRC is the STM32 CRC unit's (poly 0x04C11DB7, init 0xFFFFFFFF, no reflection, no final xor)
+ * over everything before it, fed as little-endian words with the last one padded with zeros.
+ * Building with CMD_LINK_HOST calculates the same CRC in software, for the host tests.
+ * Multi-byte values are little-endian.
+ *
+ * Every command gets exactly one reply with the same sequence number, the opcode with
+ * CMD_LINK_REPLY set, and a cmd_link_status_t as the first payload byte. Frames that fail
+ * their CRC or don't decode get no reply, the host retries them. A command repeating the
+ * sequence number of the last one is a retry of it: its reply is sent again and it isn't rerun.
+ * Replies start with a 0x00 too, so they're easy to pick out of menu text still being sent.
+ * Keep tools/funcgen_link.py in sync.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/** Largest decoded frame, including the sequence number, opcode and CRC. */
+#define CMD_LINK_MAX_FRAME	256
+/** Byte that ends a frame, and opens the link from a menu. */
+#define CMD_LINK_DELIM		0x00
+/** Set in the opcode of a reply. */
+#define CMD_LINK_REPLY		0x80
+/** Version reported by CMD_LINK_PING, bump it when the commands change. */
+#define CMD_LINK_VERSION	1
+
+/** The commands. */
+typedef enum _cmd_link_op_t {
+	/** No payload, replies with u8 CMD_LINK_VERSION and u32 profiler clock rate in Hz */
+	CMD_LINK_PING = 0x01,
+	/** No payload, replies then returns to the menus */
+	CMD_LINK_CLOSE = 0x02,
+	/**
+	 * Waveform, then any number of (param, u32 value) in the units and ranges of the menus.
+	 * The params are applied together. PARAM_ENABLE is set with CMD_LINK_ENABLE instead.
+	 */
+	CMD_LINK_SET = 0x10,
+	/**
+	 * Waveform, replies with its status: u32 frequency in mHz, u32 sample rate,
+	 * u8 amplitude, u8 duty cycle and u8 non-zero if the output is enabled.
+	 */
+	CMD_LINK_GET = 0x11,
+	/** Waveform, then u8 non-zero to enable its output or 0 to disable it. Enabling one disables the others. */
+	CMD_LINK_ENABLE = 0x12,
+	/** No payload, replies with u8 number of metrics, then u32 value and u32 max of each */
+	CMD_LINK_STATS = 0x20,
+	/**
+	 * u16 index of the first record to read, the trace is paused until they're all read.
+	 * Replies with u16 number of records held, u16 index of the first record sent, then as many
+	 * records of u32 time, u8 event, u8 arg and u16 data as fit. The reply holding the last
+	 * record clears the trace and starts recording again, so does any other command in the middle of a read.
+	 */
+	CMD_LINK_TRACE = 0x21,
+} cmd_link_op_t;
+
+/** The result of a command, the first byte of its reply. */
+typedef enum _cmd_link_status_t {
+	CMD_LINK_OK,
+	/** Unknown opcode */
+	CMD_LINK_ERR_OP,
+	/** Payload too short or too long for the opcode */
+	CMD_LINK_ERR_LEN,
+	/** Unknown waveform or param, or a value out of range */
+	CMD_LINK_ERR_ARG,
+	/** The config couldn't be sent to the waveform thread */
+	CMD_LINK_ERR_BUSY,
+} cmd_link_status_t;
+
+/** Initialize the CRC unit for the link. */
+void cmd_link_init(void);
+/**
+ * Runs commands from the UART until the host closes the link.
+ * Call from the UART thread after reading the CMD_LINK_DELIM that opened it.
+ */
+void cmd_link_run(void);
@@ -0,0 +1,110 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "cpu_load.h"
+#include "global.h"
+#include "profile.h"
+#include "stack_watch.h"
+
+/** Idle time counted over one window. */
+typedef struct _load_window_t {
+	/** Length of the window in cycles */
+	uint32_t lenCycles;
+	/** Cycle count at the start of the window */
+	uint32_t start;
+	/** Cycles spent idle since the start of the window */
+	uint32_t idleCycles;
+	/** Wakeups since the start of the window */
+	uint32_t wakeupCount;
+	/** Load over the last full window, in 0.1% steps */
+	volatile uint16_t permille;
+	/** Wakeups over the last full window, scaled to the window length */
+	volatile uint32_t wakeups;
+} load_window_t;
+
+// only written with interrupts held off, by the idle demon and the reads
+static load_window_t windows[CPU_LOAD_NUM_WINDOWS];
+// set once the idle demon has registered its stack
+static uint8_t bStackWatched = 0;
+
+/** Closes the windows that have run their length by now. Interrupts have to be held off. */
+static void close_windows(uint32_t now)
+{
+	for (uint8_t i = 0; i < CPU_LOAD_NUM_WINDOWS; ++i) {
+		load_window_t *window = &windows[i];
+		uint32_t const elapsed = now - window->start;
+		if (elapsed >= window->lenCycles) {
+			// close the window, the busy time is whatever wasn't idle
+			uint32_t const idle = (window->idleCycles < elapsed) ? window->idleCycles : elapsed;
+			window->permille = 1000 - (uint32_t)((uint64_t)idle * 1000 / elapsed);
+			// a tickless sleep or a busy stretch can run past the end of the window, scale back to its length
+			window->wakeups = (uint64_t)window->wakeupCount * window->lenCycles / elapsed;
+			window->start = now;
+			window->idleCycles = 0;
+			window->wakeupCount = 0;
+		}
+	}
+}
+
+void cpu_load_init(void)
+{
+	windows[CPU_LOAD_100MS].lenCycles = SystemCoreClock / 10;
+	windows[CPU_LOAD_1S].lenCycles = SystemCoreClock;
+
+	uint32_t const now = profile_now();
+	for (uint8_t i = 0; i < CPU_LOAD_NUM_WINDOWS; ++i) {
+		windows[i].start = now;
+		windows[i].idleCycles = 0;
+		windows[i].wakeupCount = 0;
+		windows[i].permille = 0;
+		windows[i].wakeups = 0;
+	}
+}
+
+void cpu_load_idle(void)
+{
+	if (!bStackWatched) {
+		// the idle demon has no entry of its own, register its stack on the first pass
+		stack_watch_register(STACK_WATCH_IDLE);
+		bStackWatched = 1;
+	}
+
+	// hold off interrupts while asleep, WFI still wakes on a pending one but it isn't
+	// serviced until they're enabled again, so its time isn't counted as idle
+	// the cycle counter only keeps counting through WFI because profile_init sets DBG_SLEEP
+	__disable_irq();
+	uint32_t const start = profile_now();
+	__WFI();
+	uint32_t const now = profile_now();
+	// count the sleep before the interrupt that ended it can switch to a thread, so a read
+	// from that thread already has it
+	for (uint8_t i = 0; i < CPU_LOAD_NUM_WINDOWS; ++i) {
+		windows[i].idleCycles += now - start;
+		++windows[i].wakeupCount;
+	}
+	close_windows(now);
+	__enable_irq();
+}
+
+uint16_t cpu_load_permille(cpu_load_window_t window)
+{
+	// the idle demon doesn't run under full load, close the window here if it's run its length
+	__disable_irq();
+	close_windows(profile_now());
+	uint16_t const permille = windows[window].permille;
+	__enable_irq();
+	return permille;
+}
+
+uint32_t cpu_load_wakeups(cpu_load_window_t window)
+{
+	__disable_irq();
+	close_windows(profile_now());
+	uint32_t const wakeups = windows[window].wakeups;
+	__enable_irq();
+	return wakeups;
+}
@@ -0,0 +1,41 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * CPU load meter, run by the RTX idle demon.
+ * The cycles spent asleep in the idle demon are counted against the cycles that
+ * passed over fixed windows, and the busy fraction of the last full window is kept,
+ * along with how many times the CPU woke up in it.
+ * A window is closed by the idle demon, or by a read once it has run its length, so
+ * under full load, when the idle demon never runs, the load still reads 100%.
+ * RTX 4 has no thread switch hook, so the load isn't broken down per thread,
+ * the profiler probes cover the interrupts and the waveform config paths instead.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/** Windows the load is measured over. */
+typedef enum _cpu_load_window_t {
+	/** Last 100 ms */
+	CPU_LOAD_100MS,
+	/** Last 1 s */
+	CPU_LOAD_1S,
+
+	CPU_LOAD_NUM_WINDOWS,
+} cpu_load_window_t;
+
+/** Initialize the load windows, the profiler clock has to be running. */
+void cpu_load_init(void);
+/**
+ * Sleeps until an interrupt is pending and counts the time asleep as idle.
+ * Called over and over by the RTX idle demon.
+ */
+void cpu_load_idle(void);
+/** Returns the CPU load over the last full window, in 0.1% steps. */
+uint16_t cpu_load_permille(cpu_load_window_t window);
+/** Returns the number of times the CPU woke from idle over the last full window, per window length. */
+uint32_t cpu_load_wakeups(cpu_load_window_t window);
@@ -0,0 +1,100 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Direct digital synthesis (DDS) helpers shared by the waveforms.
+ * The phase of a waveform is a 32-bit accumulator where 2^32 is one full period.
+ * Every sample the tuning word is added to the accumulator, and the output is
+ * looked up from the upper bits of the phase, so no divide is needed per sample.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Calculates the tuning word for a frequency in millihertz at the given sample rate.
+ * The tuning word is the phase step per sample, f * 2^32 / fs.
+ */
+static inline uint32_t dds_tuning_word_mhz(uint32_t freqMhz, uint32_t sampleRateHz)
+{
+	uint64_t const sampleRateMhz = (uint64_t)sampleRateHz * 1000;
+	// round to the nearest step, frequencies at or above fs wrap around like the hardware would
+	return (uint32_t)((((uint64_t)freqMhz << 32) + (sampleRateMhz >> 1)) / sampleRateMhz);
+}
+
+/** Calculates the tuning word that steps through a number of periods in exactly len samples. */
+static inline uint32_t dds_tuning_word_len(uint32_t len, uint32_t periods)
+{
+	return (uint32_t)((((uint64_t)periods << 32) + (len >> 1)) / len);
+}
+
+/** Returns the current phase and advances the accumulator by one sample. */
+static inline uint32_t dds_next(uint32_t *phase, uint32_t tuningWord)
+{
+	uint32_t const cur = *phase;
+	*phase = cur + tuningWord;
+	return cur;
+}
+
+/** Rising ramp over one period, 0 at phase 0 up to 0xFFFF just before the wrap. */
+static inline uint16_t dds_ramp(uint32_t phase)
+{
+	return phase >> 16;
+}
+
+/** Triangle over one period, 0 at phase 0 up to 0xFFFF at the half period and back down. */
+static inline uint16_t dds_triangle(uint32_t phase)
+{
+	// fold the second half of the period back onto the first half
+	if (phase & 0x80000000) {
+		phase = ~phase;
+	}
+	return phase >> 15;
+}
+
+/**
+ * Sine over one period from a table of its first quarter, 0x8000 at phase 0 up to 0xFFFF at the
+ * quarter period. The table holds 2^bits steps from 0 to 0xFFFF plus the peak again at the end,
+ * the rest of the period is folded onto it and the phase bits below the index interpolate between entries.
+ */
+static inline uint16_t dds_sine_quarter(uint16_t const *table, uint8_t bits, uint32_t phase)
+{
+	// the top 2 bits of the phase are the quarter of the period
+	uint32_t const quarter = phase >> 30;
+	// phase within the quarter, the 2nd and 4th quarters run backwards through the table
+	uint32_t quarterPhase = phase & 0x3FFFFFFF;
+	if (quarter & 1) {
+		quarterPhase = 0x3FFFFFFF - quarterPhase;
+	}
+
+	// next bits index the table, the 16 bits below them interpolate between entries
+	uint32_t const idx = quarterPhase >> (30 - bits);
+	uint32_t const frac = (quarterPhase >> (14 - bits)) & 0xFFFF;
+	uint32_t const lo = table[idx];
+	uint32_t const value = lo + (((table[idx + 1] - lo) * frac) >> 16);
+
+	// first half of the period is above the midpoint, second half is mirrored below it
+	return (quarter < 2) ? (0x10000 + value) >> 1 : (0x10000 - value) >> 1;
+}
+
+/**
+ * Calculates the Q32 scale factor for an amplitude, for use with dds_scale.
+ * amplitude * 0x10001 is amplitude / 0xFFFF in Q32, just under by a factor of (1 - 2^-32).
+ */
+static inline uint32_t dds_amplitude_scale(uint16_t amplitude)
+{
+	return (uint32_t)amplitude * 0x10001;
+}
+
+/**
+ * Scales a sample by an amplitude, without a divide.
+ * Matches sample * amplitude / 0xFFFF exactly for every 16-bit sample and amplitude,
+ * the rounding constant makes up for the scale factor being slightly under.
+ */
+static inline uint16_t dds_scale(uint16_t sample, uint32_t scale)
+{
+	return (uint16_t)(((uint64_t)sample * scale + 0xFFFF) >> 32);
+}
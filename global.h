@@ -12,3 +12,5 @@
 #include <stdint.h>
 
 #define WAVEFORM_PORT	GPIOB
+// timers on APB1 and APB2 are clocked at the 72 MHz system clock
+#define TIM_CLK_HZ		72000000
@@ -10,37 +10,40 @@
  * - Triangle
  * - Sawtooth
  * - Sine
- * Waveforms can be selected and configured using USART1.
+ * Waveforms can be selected and configured using USART1,
+ * from the menus or by scripts over a binary command link.
  * The CPU is put into a low power mode while idle.
  */
 
 #include "global.h"
-#include "pwm_wave.h"
-#include "sawtooth_wave.h"
-#include "sine_wave.h"
-#include "triangle_wave.h"
+#include "cpu_load.h"
+#include "profile.h"
+#include "tickless.h"
 #include "uart_handler.h"
+#include "wave_out.h"
+#include "waveform.h"
 
-// user IO thread gets higher priority, the other
-// threads just manage configuration params
-osThreadDef(uart_handler_thread, osPriorityAboveNormal, 1, 0);
-osThreadDef(pwm_wave_thread, osPriorityNormal, 1, 0);
-osThreadDef(sawtooth_wave_thread, osPriorityNormal, 1, 0);
-osThreadDef(sine_wave_thread, osPriorityNormal, 1, 0);
-osThreadDef(triangle_wave_thread, osPriorityNormal, 1, 0);
+// the waveform thread applies a config param as soon as it's sent, above the user IO thread,
+// so the published status the menus read back is always up to date
+// the UART thread gets its own stack, the command link nests a 32 byte chunk, the frame handler,
+// the command's batch and status and a mailbox put in the menus' call chain, more than the default 64 words
+// the waveform thread runs a batch from the mailbox through disable_others, the waveform's set,
+// wave_out_play and start_table with the trace and profiler calls, also more than the default 64 words
+// keep OS_PRIVSTKSIZE in RTX_Conf_CM.c in step with both
+#define UART_THREAD_STACK_BYTES		640
+#define WAVEFORM_THREAD_STACK_BYTES	640
+osThreadDef(uart_handler_thread, osPriorityAboveNormal, 1, UART_THREAD_STACK_BYTES);
+osThreadDef(waveform_thread, osPriorityHigh, 1, WAVEFORM_THREAD_STACK_BYTES);
 
 osThreadId T_uart_thread;
-osThreadId T_pwm_thread;
-osThreadId T_sawtooth_thread;
-osThreadId T_sine_thread;
-osThreadId T_triangle_thread;
+osThreadId T_waveform_thread;
 
 // config for the waveform GPIO port
 static GPIO_InitTypeDef _WAVEFORM_PORT_Conf = {
 	// use all pins
 	.GPIO_Pin = GPIO_Pin_All,
-	// 2 MHz is sufficient, our waves can only go up to 1 kHz
-	.GPIO_Speed = GPIO_Speed_2MHz,
+	// DMA streams samples at up to 500 kHz, 2 MHz edges are too slow for that
+	.GPIO_Speed = GPIO_Speed_10MHz,
 	// we're outputing to the pins, pull-up/pull-down
 	.GPIO_Mode = GPIO_Mode_Out_PP
 };
@@ -53,22 +56,28 @@ int main (void)
 {
 	osKernelInitialize();                    						// initialize CMSIS-RTOS
 
+	// start the cycle counter for the profiler and the output engine timing
+	profile_init();
+	// the idle demon measures the CPU load from the cycle counter
+	cpu_load_init();
+	// and sleeps with the tick stopped, woken by TIM4
+	tickless_init();
 	// initialize the waveform port
 	GPIO_Init(WAVEFORM_PORT, &_WAVEFORM_PORT_Conf);
+	// initialize the DMA output engine for the waveform port
+	wave_out_init();
 	// initialize UART for user IO
 	uart_handler_init();
 	// initialize all the waveforms
-	pwm_wave_init();
-	sawtooth_wave_init();
-	sine_wave_init();
-	triangle_wave_init();
+	waveform_init();
 
 	// create threads for user IO and the waveforms
 	T_uart_thread = osThreadCreate(osThread(uart_handler_thread), NULL);
-	T_pwm_thread = osThreadCreate(osThread(pwm_wave_thread), NULL);
-	T_sawtooth_thread = osThreadCreate(osThread(sawtooth_wave_thread), NULL);
-	T_sine_thread = osThreadCreate(osThread(sine_wave_thread), NULL);
-	T_triangle_thread = osThreadCreate(osThread(triangle_wave_thread), NULL);
+	T_waveform_thread = osThreadCreate(osThread(waveform_thread), NULL);
+	if (T_uart_thread == NULL || T_waveform_thread == NULL) {
+		// out of thread slots or stacks in RTX_Conf_CM.c, nothing would ever be applied, stop here
+		while (1);
+	}
 
 	osKernelStart();                         						// start thread execution
 }
@@ -0,0 +1,64 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "metrics.h"
+
+volatile uint32_t metricValues[METRIC_NUM];
+volatile uint32_t metricMax[METRIC_NUM];
+
+/** How a metric is reported. */
+typedef struct _metric_info_t {
+	/** Name of the metric */
+	char const *name;
+	/** Non-zero for a gauge, which has a high-water mark and isn't cleared by a reset */
+	uint8_t bGauge;
+} metric_info_t;
+
+// names and kinds of the metrics, in the order of metric_t
+static metric_info_t const metricInfo[METRIC_NUM] = {
+	[METRIC_UART_RX_DEPTH] = { "uart rx depth", 1 },
+	[METRIC_UART_RX_DROPS] = { "uart rx drops", 0 },
+	[METRIC_UART_OVERRUNS] = { "uart overruns", 0 },
+	[METRIC_UART_TX_STALLS] = { "uart tx stalls", 0 },
+	[METRIC_UART_TX_STALL_US] = { "uart tx stall us", 0 },
+	[METRIC_CFG_Q_DEPTH] = { "cfg mailbox depth", 1 },
+	[METRIC_CFG_Q_DROPS] = { "cfg mailbox drops", 0 },
+	[METRIC_CFG_APPLIED] = { "cfg applied", 0 },
+	[METRIC_REFILLS] = { "stream refills", 0 },
+	[METRIC_SAMPLES] = { "samples generated", 0 },
+	[METRIC_LINK_CMDS] = { "link commands", 0 },
+	[METRIC_LINK_ERRORS] = { "link bad frames", 0 },
+};
+
+void metrics_read(metric_t metric, uint32_t *value, uint32_t *max)
+{
+	*value = metricValues[metric];
+	*max = metricMax[metric];
+}
+
+uint8_t metrics_is_gauge(metric_t metric)
+{
+	return metricInfo[metric].bGauge;
+}
+
+char const *metrics_name(metric_t metric)
+{
+	return metricInfo[metric].name;
+}
+
+void metrics_reset(void)
+{
+	for (metric_t metric = 0; metric < METRIC_NUM; ++metric) {
+		if (metricInfo[metric].bGauge) {
+			// a gauge still holds what's queued, start its mark over from there
+			metricMax[metric] = metricValues[metric];
+		} else {
+			// a single store, an update that was interrupted by it retries its exclusive store
+			metricValues[metric] = 0;
+		}
+	}
+}
@@ -0,0 +1,109 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Runtime counters and gauges.
+ * A counter only goes up, a gauge goes up and down and remembers its high-water mark.
+ * Every update is an exclusive load/store on the value, so the same metric can be
+ * updated from threads and interrupts without locking or masking interrupts.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "stm32f10x.h"
+
+/** The metrics. */
+typedef enum _metric_t {
+	/** Gauge: received characters waiting in the UART receive ring */
+	METRIC_UART_RX_DEPTH,
+	/** Counter: received characters overwritten before the UART thread read them */
+	METRIC_UART_RX_DROPS,
+	/** Counter: characters lost to a receiver overrun before the interrupt read them */
+	METRIC_UART_OVERRUNS,
+	/** Counter: times the UART thread waited for room in the transmit ring */
+	METRIC_UART_TX_STALLS,
+	/** Counter: time the UART thread spent waiting for room in the transmit ring, in us */
+	METRIC_UART_TX_STALL_US,
+	/** Gauge: config messages waiting in the waveform mailbox */
+	METRIC_CFG_Q_DEPTH,
+	/** Counter: config messages dropped because the mailbox was full */
+	METRIC_CFG_Q_DROPS,
+	/** Counter: config messages applied by the waveform thread */
+	METRIC_CFG_APPLIED,
+	/** Counter: stream refill interrupts run */
+	METRIC_REFILLS,
+	/** Counter: samples generated, by stream refills and table renders */
+	METRIC_SAMPLES,
+	/** Counter: commands run over the binary link, not counting retries */
+	METRIC_LINK_CMDS,
+	/** Counter: binary link frames dropped for a bad CRC or encoding, or for being too long */
+	METRIC_LINK_ERRORS,
+
+	METRIC_NUM,
+} metric_t;
+
+/** Current value and high-water mark of each metric, updated through the functions below. */
+extern volatile uint32_t metricValues[METRIC_NUM];
+extern volatile uint32_t metricMax[METRIC_NUM];
+
+/** Adds n to a metric, returns the new value. */
+static inline uint32_t metrics_add(metric_t metric, uint32_t n)
+{
+	uint32_t value;
+	// an update from an interrupt in between makes the store fail and retry
+	do {
+		value = __LDREXW(&metricValues[metric]) + n;
+	} while (__STREXW(value, &metricValues[metric]));
+	return value;
+}
+
+/** Counts one event. */
+static inline void metrics_inc(metric_t metric)
+{
+	metrics_add(metric, 1);
+}
+
+/** Raises the high-water mark of a gauge to value if it's higher. */
+static inline void metrics_gauge_mark(metric_t metric, uint32_t value)
+{
+	// only ever raise the mark, even if a higher one is stored in between
+	uint32_t max;
+	do {
+		max = __LDREXW(&metricMax[metric]);
+		if (value <= max) {
+			__CLREX();
+			return;
+		}
+	} while (__STREXW(value, &metricMax[metric]));
+}
+
+/** Raises a gauge by one, updating its high-water mark. */
+static inline void metrics_gauge_up(metric_t metric)
+{
+	metrics_gauge_mark(metric, metrics_add(metric, 1));
+}
+
+/** Sets a gauge that has a single writer, updating its high-water mark. */
+static inline void metrics_gauge_set(metric_t metric, uint32_t value)
+{
+	metricValues[metric] = value;
+	metrics_gauge_mark(metric, value);
+}
+
+/** Lowers a gauge by one. */
+static inline void metrics_gauge_down(metric_t metric)
+{
+	metrics_add(metric, (uint32_t)-1);
+}
+
+/** Reads a metric, and its high-water mark if it's a gauge. */
+void metrics_read(metric_t metric, uint32_t *value, uint32_t *max);
+/** Returns non-zero if the metric is a gauge. */
+uint8_t metrics_is_gauge(metric_t metric);
+/** Returns the name of a metric. */
+char const *metrics_name(metric_t metric);
+/** Clears the counters and brings the high-water marks of the gauges down to their current values. */
+void metrics_reset(void);
@@ -0,0 +1,71 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "profile.h"
+#include <string.h>
+
+// time recorded by each probe
+static profile_stats_t probes[PROFILE_NUM_PROBES];
+
+// names of the probes, in the order of profile_probe_t
+static char const *const probeNames[PROFILE_NUM_PROBES] = {
+	[PROFILE_STREAM_REFILL] = "stream refill",
+	[PROFILE_TABLE_RENDER] = "table render",
+	[PROFILE_UART_IRQ] = "uart rx irq",
+	[PROFILE_SEND_TEXT] = "send text",
+	[PROFILE_PWM_CFG] = "pwm cfg",
+	[PROFILE_SAWTOOTH_CFG] = "sawtooth cfg",
+	[PROFILE_SINE_CFG] = "sine cfg",
+	[PROFILE_TRIANGLE_CFG] = "triangle cfg",
+	[PROFILE_MENU_RENDER] = "menu render",
+};
+
+void profile_init(void)
+{
+#ifndef PROFILE_HOST
+	// enable the cycle counter
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	// WFI stops the core clock and the cycle counter with it unless a debugger asked for it
+	// to keep running, keep it running so idle time and timestamps across a sleep are counted
+	// this costs the core clock's share of the sleep current, the CPU still halts until an interrupt
+	DBGMCU->CR |= DBGMCU_CR_DBG_SLEEP;
+#endif
+	profile_reset();
+}
+
+void profile_end(profile_probe_t probe, uint32_t start)
+{
+	// unsigned subtraction handles the clock wrapping
+	uint32_t const elapsed = profile_now() - start;
+	profile_stats_t *stats = &probes[probe];
+
+	if (stats->count == 0 || elapsed < stats->min) {
+		stats->min = elapsed;
+	}
+	if (elapsed > stats->max) {
+		stats->max = elapsed;
+	}
+	stats->total += elapsed;
+	++stats->count;
+}
+
+void profile_read(profile_probe_t probe, profile_stats_t *stats)
+{
+	*stats = probes[probe];
+}
+
+char const *profile_name(profile_probe_t probe)
+{
+	return probeNames[probe];
+}
+
+void profile_reset(void)
+{
+	memset(probes, 0, sizeof(probes));
+}
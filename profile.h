@@ -0,0 +1,95 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Cycle counter profiler for the hot paths.
+ * A probe is started by reading the clock and ended with the probe it belongs to,
+ * which records the count, min, max and total time spent in it.
+ * On the target the clock is the DWT cycle counter, kept running through WFI sleep so it
+ * also times the idle demon. Building with PROFILE_HOST
+ * uses the host monotonic clock in ns instead, so the same report can be made in simulation.
+ *
+ * Each probe has one writer, a thread or an interrupt, so updates don't lock.
+ * A report racing an update may mix old and new values of that one probe.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef PROFILE_HOST
+#include <time.h>
+#else
+#include "stm32f10x.h"
+#endif
+
+/** The probe points. */
+typedef enum _profile_probe_t {
+	/** Stream refill of half the output buffer, DMA interrupt */
+	PROFILE_STREAM_REFILL,
+	/** Table render of whole periods, waveform thread */
+	PROFILE_TABLE_RENDER,
+	/** Received characters, UART idle line and receive DMA interrupts */
+	PROFILE_UART_IRQ,
+	/** Sending a menu string, UART thread */
+	PROFILE_SEND_TEXT,
+	/** Applying a PWM config param */
+	PROFILE_PWM_CFG,
+	/** Applying a sawtooth config param */
+	PROFILE_SAWTOOTH_CFG,
+	/** Applying a sine config param */
+	PROFILE_SINE_CFG,
+	/** Applying a triangle config param */
+	PROFILE_TRIANGLE_CFG,
+	/** Printing a waveform config menu, from the status read to the prompt */
+	PROFILE_MENU_RENDER,
+
+	PROFILE_NUM_PROBES,
+} profile_probe_t;
+
+/** Time recorded by a probe. */
+typedef struct _profile_stats_t {
+	/** Number of times the probe ended */
+	uint32_t count;
+	/** Shortest time */
+	uint32_t min;
+	/** Longest time */
+	uint32_t max;
+	/** Sum of all times, for the mean */
+	uint64_t total;
+} profile_stats_t;
+
+#ifdef PROFILE_HOST
+/** Name of the profiler time unit. */
+#define PROFILE_UNIT	"ns"
+
+/** Reads the profiler clock. */
+static inline uint32_t profile_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+#else
+/** Name of the profiler time unit. */
+#define PROFILE_UNIT	"cycles"
+
+/** Reads the profiler clock. */
+static inline uint32_t profile_now(void)
+{
+	return DWT->CYCCNT;
+}
+#endif
+
+/** Initialize the profiler clock and clear all probes. */
+void profile_init(void);
+/** Ends a probe started at start, recording the time since. */
+void profile_end(profile_probe_t probe, uint32_t start);
+/** Reads the time recorded by a probe. */
+void profile_read(profile_probe_t probe, profile_stats_t *stats);
+/** Returns the name of a probe. */
+char const *profile_name(profile_probe_t probe);
+/** Clears all probes. */
+void profile_reset(void);
@@ -0,0 +1,156 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "pwm_timer.h"
+#include "global.h"
+#include "trace.h"
+
+// TIM3 times the PWM edges
+#define PWM_TIM			TIM3
+// DMA1 channel 3 is wired to the TIM3 update request, start of the period
+#define PWM_HIGH_DMA_CH	DMA1_Channel3
+// DMA1 channel 6 is wired to the TIM3 compare 1 request, end of the on time
+#define PWM_LOW_DMA_CH	DMA1_Channel6
+
+// levels DMA copies to the waveform port on each edge
+static uint16_t pwmHigh = 0;
+static uint16_t const pwmLow = 0;
+
+void pwm_timer_init(void)
+{
+	// enable the DMA1 and TIM3 clocks
+	RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+	RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;
+
+	// buffer ARR so new timing starts at the next period
+	PWM_TIM->CR1 = TIM_CR1_ARPE;
+	// compare 1 is frozen since only its event is used, buffer CCR1 like ARR
+	PWM_TIM->CCMR1 = TIM_CCMR1_OC1PE;
+	// request DMA at the start of the period and at the end of the on time
+	PWM_TIM->DIER = TIM_DIER_UDE | TIM_DIER_CC1DE;
+
+	// both channels copy one 16-bit level over and over into the 32-bit ODR
+	// a 0% duty cycle never arms them, both requests would come on the same tick
+	// and pulse the high level every period
+	PWM_HIGH_DMA_CH->CCR = 0;
+	PWM_HIGH_DMA_CH->CPAR = (uint32_t)&WAVEFORM_PORT->ODR;
+	PWM_HIGH_DMA_CH->CMAR = (uint32_t)&pwmHigh;
+	PWM_LOW_DMA_CH->CCR = 0;
+	PWM_LOW_DMA_CH->CPAR = (uint32_t)&WAVEFORM_PORT->ODR;
+	PWM_LOW_DMA_CH->CMAR = (uint32_t)&pwmLow;
+}
+
+void pwm_timer_calc(pwm_timer_cfg_t *cfg, uint32_t freqMhz, uint16_t dutyCycle_q0d10)
+{
+	// round the period to the nearest timer clock, the frequency is in mHz
+	uint64_t ticks = (TIM_CLK_HZ * 1000ull + (freqMhz >> 1)) / freqMhz;
+	// the prescaler and counter are both 16 bits, clamp to the longest period they can count
+	if (ticks > 0xFFFFull * 0x10000) {
+		ticks = 0xFFFFull * 0x10000;
+	}
+
+	// smallest prescaler that keeps the counts per period below 0x10000
+	uint32_t prescaler = ticks >> 16;
+	// prefer a slightly larger prescaler that divides the period exactly
+	for (uint32_t psc = prescaler; psc < prescaler + 0x100 && psc <= 0xFFFF; ++psc) {
+		if (ticks % (psc + 1) == 0) {
+			prescaler = psc;
+			break;
+		}
+	}
+	// round to the nearest count, the counter counts (reload + 1) per period
+	uint32_t counts = (ticks + ((prescaler + 1) >> 1)) / (prescaler + 1);
+	if (counts > 0xFFFF) {
+		counts = 0xFFFF;
+	}
+
+	cfg->prescaler = prescaler;
+	cfg->reload = counts - 1;
+	// at 100% the compare is past the reload value, so the low edge never happens
+	cfg->compare = (counts * dutyCycle_q0d10) >> 10;
+}
+
+/** Writes the timing to the timer preload registers, they're all latched by the same update. */
+static inline void write_timing(pwm_timer_cfg_t const *cfg, uint16_t amplitude)
+{
+	// keep interrupts from stretching the window the updates are held off for
+	__disable_irq();
+	uint16_t const before = PWM_TIM->CNT;
+	// hold off the update event so it can't latch a mix of old and new registers
+	PWM_TIM->CR1 |= TIM_CR1_UDIS;
+	pwmHigh = amplitude;
+	PWM_TIM->PSC = cfg->prescaler;
+	PWM_TIM->ARR = cfg->reload;
+	PWM_TIM->CCR1 = cfg->compare;
+	PWM_TIM->CR1 &= ~TIM_CR1_UDIS;
+	if (PWM_TIM->CNT < before) {
+		// the period ended while updates were held off, so neither the new timing nor the
+		// high edge's DMA request happened, start the next period now with them
+		PWM_TIM->EGR = TIM_EGR_UG;
+	}
+	__enable_irq();
+}
+
+void pwm_timer_start(pwm_timer_cfg_t const *cfg, uint16_t amplitude)
+{
+	// stop the PWM in progress before reprogramming
+	pwm_timer_stop();
+	if (cfg->compare == 0) {
+		// 0% duty cycle, there are no edges, hold the port low like a 0 frequency
+		GPIO_Write(WAVEFORM_PORT, pwmLow);
+		return;
+	}
+	write_timing(cfg, amplitude);
+
+	// rearm both DMA channels on their level
+	PWM_HIGH_DMA_CH->CNDTR = 1;
+	PWM_HIGH_DMA_CH->CCR = DMA_CCR1_PL_1 | DMA_CCR1_MSIZE_0 | DMA_CCR1_PSIZE_1
+		| DMA_CCR1_CIRC | DMA_CCR1_DIR | DMA_CCR1_EN;
+	PWM_LOW_DMA_CH->CNDTR = 1;
+	PWM_LOW_DMA_CH->CCR = DMA_CCR1_PL_1 | DMA_CCR1_MSIZE_0 | DMA_CCR1_PSIZE_1
+		| DMA_CCR1_CIRC | DMA_CCR1_DIR | DMA_CCR1_EN;
+
+	// load the preload registers, this update also writes the first high level
+	PWM_TIM->CNT = 0;
+	PWM_TIM->EGR = TIM_EGR_UG;
+	PWM_TIM->CR1 |= TIM_CR1_CEN;
+	trace_event(TRACE_OUT_PWM, 0, cfg->reload);
+}
+
+void pwm_timer_update(pwm_timer_cfg_t const *cfg, uint16_t amplitude)
+{
+	if (cfg->compare == 0) {
+		// down to a 0% duty cycle, stop and hold the port low
+		pwm_timer_stop();
+		GPIO_Write(WAVEFORM_PORT, pwmLow);
+		return;
+	}
+	if (!pwm_timer_running()) {
+		// up from a 0% duty cycle, start from the beginning of a period
+		pwm_timer_start(cfg, amplitude);
+		return;
+	}
+	// PSC is always buffered, ARR and CCR1 are buffered by ARPE and OC1PE,
+	// the new values take effect together at the next natural update
+	write_timing(cfg, amplitude);
+	trace_event(TRACE_OUT_PWM, 1, cfg->reload);
+}
+
+uint8_t pwm_timer_running(void)
+{
+	return (PWM_TIM->CR1 & TIM_CR1_CEN) != 0;
+}
+
+void pwm_timer_stop(void)
+{
+	if (pwm_timer_running()) {
+		trace_event(TRACE_OUT_STOP, 1, 0);
+	}
+	PWM_TIM->CR1 &= ~TIM_CR1_CEN;
+	PWM_HIGH_DMA_CH->CCR &= ~DMA_CCR1_EN;
+	PWM_LOW_DMA_CH->CCR &= ~DMA_CCR1_EN;
+}
@@ -0,0 +1,46 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Hardware timer backend for the PWM waveform.
+ * TIM3 update events request DMA1 channel 3, which writes the high level to the
+ * waveform port at the start of each period. TIM3 compare 1 events request DMA1
+ * channel 6, which writes 0 at the end of the on time. Both edges are timed by
+ * hardware to one timer clock, so the CPU does no work while the PWM is running.
+ */
+
+#pragma once
+
+#include "global.h"
+
+/** TIM3 register values for a PWM period and duty cycle. */
+typedef struct _pwm_timer_cfg_t {
+	/** Timer clock prescaler, PSC */
+	uint16_t prescaler;
+	/** Counter reload value, ARR */
+	uint16_t reload;
+	/** Compare value where the output goes low, CCR1 */
+	uint16_t compare;
+} pwm_timer_cfg_t;
+
+/** Initialize the PWM timer and its DMA channels. */
+void pwm_timer_init(void);
+/**
+ * Calculates the timer register values for a non-zero frequency in mHz and duty cycle.
+ * Periods longer than the timer can count are clamped to the longest period.
+ * A 0% duty cycle has a compare of 0, which has no edges, the output is held low instead.
+ */
+void pwm_timer_calc(pwm_timer_cfg_t *cfg, uint32_t freqMhz, uint16_t dutyCycle_q0d10);
+/** Starts the PWM from the beginning of a period, or holds the port low at a 0% duty cycle. */
+void pwm_timer_start(pwm_timer_cfg_t const *cfg, uint16_t amplitude);
+/**
+ * Updates a running PWM, the new timing takes effect at the start of the next period.
+ * Stops it and holds the port low at a 0% duty cycle, and starts it again when the duty cycle comes back.
+ */
+void pwm_timer_update(pwm_timer_cfg_t const *cfg, uint16_t amplitude);
+/** Returns non-zero if the PWM timer is running. */
+uint8_t pwm_timer_running(void);
+/** Stops the PWM, leaving the waveform port at its last value. */
+void pwm_timer_stop(void);
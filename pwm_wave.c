@@ -7,176 +7,146 @@
 
 #include "pwm_wave.h"
 #include "global.h"
+#include "pwm_timer.h"
 #include "utils.h"
 
 /** Stores the state of the PWM waveform. */
 typedef struct _pwm_state_t {
 	// configuration values
 	uint16_t amplitude;
-	uint16_t periodMs;
+	uint32_t freqMhz;
 	uint16_t dutyCycle_q0d10;
 	uint8_t bRunning;
 
 	// calculated values
-	uint16_t onTimeMs;
+	pwm_timer_cfg_t timing;
 } pwm_state_t;
 
-static uint16_t curTimeMs = 0;
-
-// mail queue of configuration parameters to apply
-static osMailQDef(pwm_cfg_q, 0x8, waveform_cfg_t);
-osMailQId Q_pwm_cfg_id;
-
-// message queue to send cfg param values from a recv request
-static osMessageQDef(pwm_cfg_recv_q, 0x8, uint32_t);
-osMessageQId Q_pwm_cfg_recv_id;
-
-// mutex to protect the shared state of the waveform
-static osMutexDef(pwm_state_m);
-osMutexId M_pwm_state;
+// state of the waveform, owned by the waveform manager thread
+static pwm_state_t curState = {
+	// initial state: 100% amplitude, 10 Hz, 50% DC, disabled
+	.amplitude = SCALE_AMPLITUDE(100),
+	.freqMhz = 10000,
+	.dutyCycle_q0d10 = SCALE_DUTYCYCLE(50),
+	.bRunning = 0,
+};
+
+/** Calculates and applies the timer values for the frequency and duty cycle to the waveform. */
+static inline void apply_timing(pwm_state_t *state)
+{
+	// a 0 frequency has no timing, the output is held at 0
+	if (state->freqMhz) {
+		pwm_timer_calc(&state->timing, state->freqMhz, state->dutyCycle_q0d10);
+	}
+}
 
-/** Runs the PWM waveform assuming the use of a 1ms timer. */
-static void pwm_run(void const *arg);
-// 1ms timer for the waveform
-static osTimerDef(pwm_run_timer, pwm_run);
-static osTimerId TMR_pwm_run_timer;
+/** Starts the output of the waveform from the beginning of a period. */
+static void start_output(pwm_state_t const *state)
+{
+	if (state->freqMhz) {
+		pwm_timer_start(&state->timing, state->amplitude);
+	} else {
+		pwm_timer_stop();
+		GPIO_Write(WAVEFORM_PORT, 0);
+	}
+}
 
-void pwm_wave_init(void)
+/** Updates the running output of the waveform, changes take effect at the next period. */
+static void update_output(pwm_state_t const *state)
 {
-	// create the mailbox, message queue, and mutex
-	Q_pwm_cfg_id = osMailCreate(osMailQ(pwm_cfg_q), NULL);
-	Q_pwm_cfg_recv_id = osMessageCreate(osMessageQ(pwm_cfg_recv_q), NULL);
-	M_pwm_state = osMutexCreate(osMutex(pwm_state_m));
+	if (state->freqMhz == 0) {
+		pwm_timer_stop();
+		GPIO_Write(WAVEFORM_PORT, 0);
+	} else if (pwm_timer_running()) {
+		pwm_timer_update(&state->timing, state->amplitude);
+	} else {
+		// coming back from a 0 frequency, the timer isn't running yet
+		pwm_timer_start(&state->timing, state->amplitude);
+	}
 }
 
-/** Sends the requested config parameter to the message queue. */
-static void send_cfg_param(pwm_state_t *state, waveform_cfg_param_t param)
+/** Reads a config parameter in the units it was sent in. */
+static uint32_t pwm_get(waveform_cfg_param_t param)
 {
 	uint32_t value = 0;
 	switch (param) {
 		case PARAM_AMPLITUDE:
-			value = AMPLITUDE_TO_USER(state->amplitude);
+			value = AMPLITUDE_TO_USER(curState.amplitude);
 			break;
-		case PARAM_PERIOD_MS:
-			value = state->periodMs;
+		case PARAM_FREQ_MHZ:
+			value = curState.freqMhz;
 			break;
 		case PARAM_DUTYCYCLE:
-			value = DUTYCYCLE_TO_USER(state->dutyCycle_q0d10);
+			value = DUTYCYCLE_TO_USER(curState.dutyCycle_q0d10);
 			break;
 		case PARAM_ENABLE:
-			value = state->bRunning;
+			value = curState.bRunning;
 			break;
 		default:
 			break;
 	}
-	osMessagePut(Q_pwm_cfg_recv_id, value, 0);
+	return value;
 }
 
-/** Applies the duty cycle to the waveform. */
-static inline void apply_dc(pwm_state_t *state)
+/** Initializes the timer and calculates the values that depend on the initial config. */
+static void pwm_init(void)
 {
-	state->onTimeMs = ((uint32_t)state->periodMs * state->dutyCycle_q0d10) >> 10;
+	// the edges are timed by TIM3
+	pwm_timer_init();
+	apply_timing(&curState);
 }
 
-void pwm_wave_thread(void const *arg)
+/** Applies a batch of config parameters, updating the output once if it's running. */
+static void pwm_set(waveform_batch_t const *batch)
 {
-	// initial state: 100% amplitude, 100ms period, 50% DC, disabled
-	pwm_state_t state = {
-		.amplitude = SCALE_AMPLITUDE(100),
-		.periodMs = 100,
-		.dutyCycle_q0d10 = SCALE_DUTYCYCLE(50),
-		.bRunning = 0,
-	};
-	apply_dc(&state);
-
-	// create the timer using state as the input param
-	TMR_pwm_run_timer = osTimerCreate(osTimer(pwm_run_timer), osTimerPeriodic, &state);
-
-	osEvent retval;
-	while (1) {
-		// wait for a new config param
-		retval = osMailGet(Q_pwm_cfg_id, osWaitForever);
-		if (retval.status == osEventMail) {
-			waveform_cfg_t *cfg = retval.value.p;
+	uint32_t value;
+	// non-zero if the running output has to pick up the new config
+	uint8_t bChanged = 0;
 
-			// lock access to the shared state
-			osMutexWait(M_pwm_state, osWaitForever);
-			switch (cfg->type) {
-				case PARAM_AMPLITUDE:
-				{
-					state.amplitude = SCALE_AMPLITUDE(cfg->value);
-					break;
-				}
-				case PARAM_PERIOD_MS:
-				{
-					state.periodMs = cfg->value;
-					apply_dc(&state);
-					break;
-				}
-				case PARAM_DUTYCYCLE:
-				{
-					state.dutyCycle_q0d10 = SCALE_DUTYCYCLE(cfg->value);
-					apply_dc(&state);
-					break;
-				}
-				case PARAM_ENABLE:
-				{
-					if (cfg->value) {
-						// toggle enable if value is non-zero
-						state.bRunning = !state.bRunning;
-					} else {
-						// otherwise disable output
-						state.bRunning = 0;
-					}
-
-					if (state.bRunning) {
-						// we are now enabled, start the timer
-						osTimerStart(TMR_pwm_run_timer, 1);
-					} else {
-						// we are now disabled, stop the timer
-						osTimerStop(TMR_pwm_run_timer);
-						// set output to 0 and reset time
-						GPIO_Write(WAVEFORM_PORT, 0);
-						curTimeMs = 0;
-					}
-					break;
-				}
-				case PARAM_RECV:
-				{
-					send_cfg_param(&state, cfg->value);
-					break;
-				}
-				default:
-					break;
-			}
-			osMutexRelease(M_pwm_state);
-
-			osMailFree(Q_pwm_cfg_id, cfg);
-		}
+	if (waveform_batch_get(batch, PARAM_AMPLITUDE, &value)) {
+		curState.amplitude = SCALE_AMPLITUDE(value);
+		bChanged = 1;
+	}
+	if (waveform_batch_get(batch, PARAM_FREQ_MHZ, &value)) {
+		curState.freqMhz = value;
+		bChanged = 1;
+	}
+	if (waveform_batch_get(batch, PARAM_DUTYCYCLE, &value)) {
+		curState.dutyCycle_q0d10 = SCALE_DUTYCYCLE(value);
+		bChanged = 1;
+	}
+	if (bChanged) {
+		// the period and duty cycle are calculated together, so there's no period with only one of them new
+		apply_timing(&curState);
 	}
-}
-
-static void pwm_run(void const *arg)
-{
-	// lock access to shared state
-	osMutexWait(M_pwm_state, osWaitForever);
-	{
-		pwm_state_t const *state = arg;
 
-		// if period has elapsed, wrap back around to 0
-		if (curTimeMs >= state->periodMs) {
-			curTimeMs = 0;
+	if (waveform_batch_get(batch, PARAM_ENABLE, &value)) {
+		uint8_t const bWasRunning = curState.bRunning;
+		if (value) {
+			// toggle enable if value is non-zero
+			curState.bRunning = !curState.bRunning;
+		} else {
+			// otherwise disable output
+			curState.bRunning = 0;
 		}
 
-		if (curTimeMs == state->onTimeMs) {
-			// onTime has elapsed, turn waveform off
+		if (curState.bRunning) {
+			// we are now enabled, start the timer
+			start_output(&curState);
+		} else if (bWasRunning) {
+			// we are now disabled, stop the timer and set output to 0
+			// left alone if it was already off, another waveform may be using the port
+			pwm_timer_stop();
 			GPIO_Write(WAVEFORM_PORT, 0);
-		} else if (curTimeMs == 0) {
-			// start of a new period, turn waveform on
-			GPIO_Write(WAVEFORM_PORT, state->amplitude);
 		}
+	} else if (bChanged && curState.bRunning) {
+		update_output(&curState);
 	}
-	osMutexRelease(M_pwm_state);
-
-	++curTimeMs;
 }
+
+/** Operations on the PWM waveform for the waveform manager. */
+waveform_ops_t const pwm_wave_ops = {
+	.init = pwm_init,
+	.set = pwm_set,
+	.get = pwm_get,
+};
@@ -7,281 +7,225 @@
 
 #include "sine_wave.h"
 #include "global.h"
+#include "dds.h"
+#include "snapshot.h"
 #include "utils.h"
+#include "wave_out.h"
 
 /** Stores the state of the sine waveform. */
 typedef struct _sine_state_t {
 	// configuration values
 	uint16_t amplitude;
-	uint16_t periodMs;
+	uint32_t freqMhz;
+	uint32_t sampleRateHz;
 	uint8_t bRunning;
+
+	// calculated values
+	uint32_t tuningWord;
+	uint32_t ampScale;
 } sine_state_t;
+// the state is published to the output stream refill
+SNAPSHOT_CHECK_SIZE(sine_state_t);
+
+// state of the waveform, owned by the waveform manager thread
+static sine_state_t curState = {
+	// initial state: 100% amplitude, 10 Hz, default sample rate, disabled
+	.amplitude = SCALE_AMPLITUDE(100),
+	.freqMhz = 10000,
+	.sampleRateHz = WAVE_OUT_DEFAULT_RATE_HZ,
+	.bRunning = 0,
+};
 
-static uint16_t curTimeMs = 0;
+static uint32_t phase = 0;
 
-// mail queue of configuration parameters to apply
-static osMailQDef(sine_cfg_q, 0x8, waveform_cfg_t);
-osMailQId Q_sine_cfg_id;
+// published copy of the state for the output stream refill
+static snapshot_t stateSnap;
 
-// message queue to send cfg param values from a recv request
-static osMessageQDef(sine_cfg_recv_q, 0x8, uint32_t);
-osMessageQId Q_sine_cfg_recv_id;
+/** Calculates the sine output sample at the given phase. */
+static inline uint16_t sine_sample(sine_state_t const *state, uint32_t curPhase);
+/** Runs the sine waveform for the next len samples of the output stream. */
+static void sine_run(void const *arg, uint16_t *buf, uint16_t len);
 
-// mutex to protect the shared state of the waveform
-static osMutexDef(sine_state_m);
-osMutexId M_sine_state;
+/** Calculates and applies the DDS tuning word to the waveform. */
+static inline void apply_tuningWord(sine_state_t *state)
+{
+	state->tuningWord = dds_tuning_word_mhz(state->freqMhz, state->sampleRateHz);
+}
 
-/** Runs the sine waveform assuming the use of a 1ms timer. */
-static void sine_run(void const *arg);
-// 1ms timer for the waveform
-static osTimerDef(sine_run_timer, sine_run);
-static osTimerId TMR_sine_run_timer;
+/** Calculates and applies the amplitude scale factor to the waveform. */
+static inline void apply_ampScale(sine_state_t *state)
+{
+	state->ampScale = dds_amplitude_scale(state->amplitude);
+}
 
-void sine_wave_init(void)
+/** Renders whole periods of the waveform into buf, for the output engine to loop. */
+static void render_periods(void const *arg, uint16_t *buf, uint16_t len, uint16_t periods)
 {
-	// create the mailbox, message queue, and mutex
-	Q_sine_cfg_id = osMailCreate(osMailQ(sine_cfg_q), NULL);
-	Q_sine_cfg_recv_id = osMessageCreate(osMessageQ(sine_cfg_recv_q), NULL);
-	M_sine_state = osMutexCreate(osMutex(sine_state_m));
+	sine_state_t const *state = arg;
+
+	uint32_t const tuningWord = dds_tuning_word_len(len, periods);
+	uint32_t renderPhase = 0;
+	for (uint16_t i = 0; i < len; ++i) {
+		buf[i] = sine_sample(state, dds_next(&renderPhase, tuningWord));
+	}
 }
 
-/** Sends the requested config parameter to the message queue. */
-static void send_cfg_param(sine_state_t *state, waveform_cfg_param_t param)
+/** Starts or updates the output of the waveform. */
+static void start_output(sine_state_t const *state)
+{
+	// publish the state, a stream in progress picks it up at its next half buffer
+	snapshot_publish(&stateSnap, state, sizeof(*state));
+	// loop whole periods if they fit in the output buffer at the sample rate, otherwise generate them live
+	wave_out_play(render_periods, sine_run, &stateSnap, state->freqMhz, state->sampleRateHz);
+}
+
+/** Reads a config parameter in the units it was sent in. */
+static uint32_t sine_get(waveform_cfg_param_t param)
 {
 	uint32_t value = 0;
 	switch (param) {
 		case PARAM_AMPLITUDE:
-			value = AMPLITUDE_TO_USER(state->amplitude);
+			value = AMPLITUDE_TO_USER(curState.amplitude);
+			break;
+		case PARAM_FREQ_MHZ:
+			value = curState.freqMhz;
 			break;
-		case PARAM_PERIOD_MS:
-			value = state->periodMs;
+		case PARAM_SAMPLE_RATE:
+			value = curState.sampleRateHz;
 			break;
 		case PARAM_ENABLE:
-			value = state->bRunning;
+			value = curState.bRunning;
 			break;
 		default:
 			break;
 	}
-	osMessagePut(Q_sine_cfg_recv_id, value, 0);
+	return value;
 }
 
-void sine_wave_thread(void const *arg)
+/** Calculates the values that depend on the initial config. */
+static void sine_init(void)
 {
-	// initial state: 100% amplitude, 100ms period, disabled
-	sine_state_t state = {
-		.amplitude = SCALE_AMPLITUDE(100),
-		.periodMs = 100,
-		.bRunning = 0,
-	};
-
-	// create the timer using state as the input param
-	TMR_sine_run_timer = osTimerCreate(osTimer(sine_run_timer), osTimerPeriodic, &state);
+	apply_tuningWord(&curState);
+	apply_ampScale(&curState);
+}
 
-	osEvent retval;
-	while (1) {
-		// wait for a new config param
-		retval = osMailGet(Q_sine_cfg_id, osWaitForever);
-		if (retval.status == osEventMail) {
-			waveform_cfg_t *cfg = retval.value.p;
+/** Applies a batch of config parameters, updating the output once if it's running. */
+static void sine_set(waveform_batch_t const *batch)
+{
+	uint32_t value;
+	// non-zero if the running output has to pick up the new config
+	uint8_t bChanged = 0;
+
+	if (waveform_batch_get(batch, PARAM_AMPLITUDE, &value)) {
+		curState.amplitude = SCALE_AMPLITUDE(value);
+		apply_ampScale(&curState);
+		bChanged = 1;
+	}
+	if (waveform_batch_get(batch, PARAM_FREQ_MHZ, &value)) {
+		curState.freqMhz = value;
+		bChanged = 1;
+	}
+	if (waveform_batch_get(batch, PARAM_SAMPLE_RATE, &value)) {
+		// ignore rates the output engine can't time
+		if (value >= WAVE_OUT_MIN_RATE_HZ && value <= WAVE_OUT_MAX_RATE_HZ) {
+			curState.sampleRateHz = value;
+			bChanged = 1;
+		}
+	}
+	if (bChanged) {
+		apply_tuningWord(&curState);
+	}
 
-			// lock access to the shared state
-			osMutexWait(M_sine_state, osWaitForever);
-			switch (cfg->type) {
-				case PARAM_AMPLITUDE:
-				{
-					state.amplitude = SCALE_AMPLITUDE(cfg->value);
-					break;
-				}
-				case PARAM_PERIOD_MS:
-				{
-					state.periodMs = cfg->value;
-					break;
-				}
-				case PARAM_ENABLE:
-				{
-					if (cfg->value) {
-						// toggle enable if value is non-zero
-						state.bRunning = !state.bRunning;
-					} else {
-						// otherwise disable output
-						state.bRunning = 0;
-					}
+	if (waveform_batch_get(batch, PARAM_ENABLE, &value)) {
+		if (value) {
+			// toggle enable if value is non-zero
+			curState.bRunning = !curState.bRunning;
+		} else {
+			// otherwise disable output
+			curState.bRunning = 0;
+		}
 
-					if (state.bRunning) {
-						// we are now enabled, start the timer
-						osTimerStart(TMR_sine_run_timer, 1);
-					} else {
-						// we are now disabled, stop the timer
-						osTimerStop(TMR_sine_run_timer);
-						// set output to 0 and reset time
-						GPIO_Write(WAVEFORM_PORT, 0);
-						curTimeMs = 0;
-					}
-					break;
-				}
-				case PARAM_RECV:
-				{
-					send_cfg_param(&state, cfg->value);
-					break;
-				}
-				default:
-					break;
+		if (curState.bRunning) {
+			// we are now enabled, start the output
+			start_output(&curState);
+		} else {
+			// we are now disabled, stop the output if it's this waveform's
+			if (wave_out_stop(&stateSnap)) {
+				// set output to 0
+				GPIO_Write(WAVEFORM_PORT, 0);
 			}
-			osMutexRelease(M_sine_state);
-
-			osMailFree(Q_sine_cfg_id, cfg);
+			// reset phase
+			phase = 0;
 		}
+	} else if (bChanged && curState.bRunning) {
+		// the output picks up every param in the batch at once
+		start_output(&curState);
 	}
 }
 
-#define SINE_LOOKUP_SZ 1000
-/** sine lookup table, one full period */
-static uint16_t const sine_lookup[SINE_LOOKUP_SZ] = {
-	0x8000,0x80cd,0x819b,0x8269,0x8337,0x8405,0x84d3,0x85a0,
-	0x866e,0x873b,0x8809,0x88d6,0x89a4,0x8a71,0x8b3e,0x8c0b,
-	0x8cd8,0x8da5,0x8e72,0x8f3e,0x900a,0x90d7,0x91a3,0x926e,
-	0x933a,0x9405,0x94d1,0x959c,0x9667,0x9731,0x97fc,0x98c6,
-	0x998f,0x9a59,0x9b22,0x9bec,0x9cb4,0x9d7d,0x9e45,0x9f0d,
-	0x9fd4,0xa09c,0xa163,0xa229,0xa2ef,0xa3b5,0xa47b,0xa540,
-	0xa605,0xa6c9,0xa78d,0xa851,0xa914,0xa9d7,0xaa99,0xab5b,
-	0xac1d,0xacde,0xad9e,0xae5e,0xaf1e,0xafdd,0xb09c,0xb15a,
-	0xb218,0xb2d5,0xb392,0xb44e,0xb50a,0xb5c5,0xb67f,0xb739,
-	0xb7f3,0xb8ac,0xb964,0xba1c,0xbad3,0xbb89,0xbc3f,0xbcf5,
-	0xbda9,0xbe5d,0xbf11,0xbfc4,0xc076,0xc128,0xc1d8,0xc289,
-	0xc338,0xc3e7,0xc495,0xc543,0xc5ef,0xc69c,0xc747,0xc7f2,
-	0xc89b,0xc945,0xc9ed,0xca95,0xcb3c,0xcbe2,0xcc87,0xcd2c,
-	0xcdd0,0xce73,0xcf15,0xcfb7,0xd057,0xd0f7,0xd196,0xd235,
-	0xd2d2,0xd36e,0xd40a,0xd4a5,0xd53f,0xd5d8,0xd670,0xd708,
-	0xd79e,0xd834,0xd8c9,0xd95d,0xd9f0,0xda82,0xdb13,0xdba3,
-	0xdc32,0xdcc1,0xdd4e,0xddda,0xde66,0xdef1,0xdf7a,0xe003,
-	0xe08a,0xe111,0xe197,0xe21c,0xe29f,0xe322,0xe3a4,0xe424,
-	0xe4a4,0xe523,0xe5a1,0xe61d,0xe699,0xe713,0xe78d,0xe805,
-	0xe87d,0xe8f3,0xe969,0xe9dd,0xea50,0xeac2,0xeb33,0xeba3,
-	0xec12,0xec80,0xecec,0xed58,0xedc3,0xee2c,0xee94,0xeefb,
-	0xef61,0xefc6,0xf02a,0xf08c,0xf0ee,0xf14e,0xf1ae,0xf20c,
-	0xf268,0xf2c4,0xf31f,0xf378,0xf3d0,0xf427,0xf47d,0xf4d2,
-	0xf526,0xf578,0xf5c9,0xf619,0xf668,0xf6b6,0xf702,0xf74d,
-	0xf797,0xf7e0,0xf827,0xf86e,0xf8b3,0xf8f7,0xf93a,0xf97b,
-	0xf9bb,0xf9fa,0xfa38,0xfa75,0xfab0,0xfaea,0xfb23,0xfb5a,
-	0xfb91,0xfbc6,0xfbfa,0xfc2c,0xfc5d,0xfc8e,0xfcbc,0xfcea,
-	0xfd16,0xfd41,0xfd6b,0xfd93,0xfdbb,0xfde1,0xfe05,0xfe29,
-	0xfe4b,0xfe6c,0xfe8b,0xfea9,0xfec6,0xfee2,0xfefd,0xff16,
-	0xff2e,0xff44,0xff5a,0xff6e,0xff80,0xff92,0xffa2,0xffb1,
-	0xffbe,0xffcb,0xffd6,0xffdf,0xffe8,0xffef,0xfff5,0xfff9,
-	0xfffc,0xfffe,0xffff,0xfffe,0xfffc,0xfff9,0xfff5,0xffef,
-	0xffe8,0xffdf,0xffd6,0xffcb,0xffbe,0xffb1,0xffa2,0xff92,
-	0xff80,0xff6e,0xff5a,0xff44,0xff2e,0xff16,0xfefd,0xfee2,
-	0xfec6,0xfea9,0xfe8b,0xfe6c,0xfe4b,0xfe29,0xfe05,0xfde1,
-	0xfdbb,0xfd93,0xfd6b,0xfd41,0xfd16,0xfcea,0xfcbc,0xfc8e,
-	0xfc5d,0xfc2c,0xfbfa,0xfbc6,0xfb91,0xfb5a,0xfb23,0xfaea,
-	0xfab0,0xfa75,0xfa38,0xf9fa,0xf9bb,0xf97b,0xf93a,0xf8f7,
-	0xf8b3,0xf86e,0xf827,0xf7e0,0xf797,0xf74d,0xf702,0xf6b6,
-	0xf668,0xf619,0xf5c9,0xf578,0xf526,0xf4d2,0xf47d,0xf427,
-	0xf3d0,0xf378,0xf31f,0xf2c4,0xf268,0xf20c,0xf1ae,0xf14e,
-	0xf0ee,0xf08c,0xf02a,0xefc6,0xef61,0xeefb,0xee94,0xee2c,
-	0xedc3,0xed58,0xecec,0xec80,0xec12,0xeba3,0xeb33,0xeac2,
-	0xea50,0xe9dd,0xe969,0xe8f3,0xe87d,0xe805,0xe78d,0xe713,
-	0xe699,0xe61d,0xe5a1,0xe523,0xe4a4,0xe424,0xe3a4,0xe322,
-	0xe29f,0xe21c,0xe197,0xe111,0xe08a,0xe003,0xdf7a,0xdef1,
-	0xde66,0xddda,0xdd4e,0xdcc1,0xdc32,0xdba3,0xdb13,0xda82,
-	0xd9f0,0xd95d,0xd8c9,0xd834,0xd79e,0xd708,0xd670,0xd5d8,
-	0xd53f,0xd4a5,0xd40a,0xd36e,0xd2d2,0xd235,0xd196,0xd0f7,
-	0xd057,0xcfb7,0xcf15,0xce73,0xcdd0,0xcd2c,0xcc87,0xcbe2,
-	0xcb3c,0xca95,0xc9ed,0xc945,0xc89b,0xc7f2,0xc747,0xc69c,
-	0xc5ef,0xc543,0xc495,0xc3e7,0xc338,0xc289,0xc1d8,0xc128,
-	0xc076,0xbfc4,0xbf11,0xbe5d,0xbda9,0xbcf5,0xbc3f,0xbb89,
-	0xbad3,0xba1c,0xb964,0xb8ac,0xb7f3,0xb739,0xb67f,0xb5c5,
-	0xb50a,0xb44e,0xb392,0xb2d5,0xb218,0xb15a,0xb09c,0xafdd,
-	0xaf1e,0xae5e,0xad9e,0xacde,0xac1d,0xab5b,0xaa99,0xa9d7,
-	0xa914,0xa851,0xa78d,0xa6c9,0xa605,0xa540,0xa47b,0xa3b5,
-	0xa2ef,0xa229,0xa163,0xa09c,0x9fd4,0x9f0d,0x9e45,0x9d7d,
-	0x9cb4,0x9bec,0x9b22,0x9a59,0x998f,0x98c6,0x97fc,0x9731,
-	0x9667,0x959c,0x94d1,0x9405,0x933a,0x926e,0x91a3,0x90d7,
-	0x900a,0x8f3e,0x8e72,0x8da5,0x8cd8,0x8c0b,0x8b3e,0x8a71,
-	0x89a4,0x88d6,0x8809,0x873b,0x866e,0x85a0,0x84d3,0x8405,
-	0x8337,0x8269,0x819b,0x80cd,0x8000,0x7f32,0x7e64,0x7d96,
-	0x7cc8,0x7bfa,0x7b2c,0x7a5f,0x7991,0x78c4,0x77f6,0x7729,
-	0x765b,0x758e,0x74c1,0x73f4,0x7327,0x725a,0x718d,0x70c1,
-	0x6ff5,0x6f28,0x6e5c,0x6d91,0x6cc5,0x6bfa,0x6b2e,0x6a63,
-	0x6998,0x68ce,0x6803,0x6739,0x6670,0x65a6,0x64dd,0x6413,
-	0x634b,0x6282,0x61ba,0x60f2,0x602b,0x5f63,0x5e9c,0x5dd6,
-	0x5d10,0x5c4a,0x5b84,0x5abf,0x59fa,0x5936,0x5872,0x57ae,
-	0x56eb,0x5628,0x5566,0x54a4,0x53e2,0x5321,0x5261,0x51a1,
-	0x50e1,0x5022,0x4f63,0x4ea5,0x4de7,0x4d2a,0x4c6d,0x4bb1,
-	0x4af5,0x4a3a,0x4980,0x48c6,0x480c,0x4753,0x469b,0x45e3,
-	0x452c,0x4476,0x43c0,0x430a,0x4256,0x41a2,0x40ee,0x403b,
-	0x3f89,0x3ed7,0x3e27,0x3d76,0x3cc7,0x3c18,0x3b6a,0x3abc,
-	0x3a10,0x3963,0x38b8,0x380d,0x3764,0x36ba,0x3612,0x356a,
-	0x34c3,0x341d,0x3378,0x32d3,0x322f,0x318c,0x30ea,0x3048,
-	0x2fa8,0x2f08,0x2e69,0x2dca,0x2d2d,0x2c91,0x2bf5,0x2b5a,
-	0x2ac0,0x2a27,0x298f,0x28f7,0x2861,0x27cb,0x2736,0x26a2,
-	0x260f,0x257d,0x24ec,0x245c,0x23cd,0x233e,0x22b1,0x2225,
-	0x2199,0x210e,0x2085,0x1ffc,0x1f75,0x1eee,0x1e68,0x1de3,
-	0x1d60,0x1cdd,0x1c5b,0x1bdb,0x1b5b,0x1adc,0x1a5e,0x19e2,
-	0x1966,0x18ec,0x1872,0x17fa,0x1782,0x170c,0x1696,0x1622,
-	0x15af,0x153d,0x14cc,0x145c,0x13ed,0x137f,0x1313,0x12a7,
-	0x123c,0x11d3,0x116b,0x1104,0x109e,0x1039,0x0fd5,0x0f73,
-	0x0f11,0x0eb1,0x0e51,0x0df3,0x0d97,0x0d3b,0x0ce0,0x0c87,
-	0x0c2f,0x0bd8,0x0b82,0x0b2d,0x0ad9,0x0a87,0x0a36,0x09e6,
-	0x0997,0x0949,0x08fd,0x08b2,0x0868,0x081f,0x07d8,0x0791,
-	0x074c,0x0708,0x06c5,0x0684,0x0644,0x0605,0x05c7,0x058a,
-	0x054f,0x0515,0x04dc,0x04a5,0x046e,0x0439,0x0405,0x03d3,
-	0x03a2,0x0371,0x0343,0x0315,0x02e9,0x02be,0x0294,0x026c,
-	0x0244,0x021e,0x01fa,0x01d6,0x01b4,0x0193,0x0174,0x0156,
-	0x0139,0x011d,0x0102,0x00e9,0x00d1,0x00bb,0x00a5,0x0091,
-	0x007f,0x006d,0x005d,0x004e,0x0041,0x0034,0x0029,0x0020,
-	0x0017,0x0010,0x000a,0x0006,0x0003,0x0001,0x0000,0x0001,
-	0x0003,0x0006,0x000a,0x0010,0x0017,0x0020,0x0029,0x0034,
-	0x0041,0x004e,0x005d,0x006d,0x007f,0x0091,0x00a5,0x00bb,
-	0x00d1,0x00e9,0x0102,0x011d,0x0139,0x0156,0x0174,0x0193,
-	0x01b4,0x01d6,0x01fa,0x021e,0x0244,0x026c,0x0294,0x02be,
-	0x02e9,0x0315,0x0343,0x0371,0x03a2,0x03d3,0x0405,0x0439,
-	0x046e,0x04a5,0x04dc,0x0515,0x054f,0x058a,0x05c7,0x0605,
-	0x0644,0x0684,0x06c5,0x0708,0x074c,0x0791,0x07d8,0x081f,
-	0x0868,0x08b2,0x08fd,0x0949,0x0997,0x09e6,0x0a36,0x0a87,
-	0x0ad9,0x0b2d,0x0b82,0x0bd8,0x0c2f,0x0c87,0x0ce0,0x0d3b,
-	0x0d97,0x0df3,0x0e51,0x0eb1,0x0f11,0x0f73,0x0fd5,0x1039,
-	0x109e,0x1104,0x116b,0x11d3,0x123c,0x12a7,0x1313,0x137f,
-	0x13ed,0x145c,0x14cc,0x153d,0x15af,0x1622,0x1696,0x170c,
-	0x1782,0x17fa,0x1872,0x18ec,0x1966,0x19e2,0x1a5e,0x1adc,
-	0x1b5b,0x1bdb,0x1c5b,0x1cdd,0x1d60,0x1de3,0x1e68,0x1eee,
-	0x1f75,0x1ffc,0x2085,0x210e,0x2199,0x2225,0x22b1,0x233e,
-	0x23cd,0x245c,0x24ec,0x257d,0x260f,0x26a2,0x2736,0x27cb,
-	0x2861,0x28f7,0x298f,0x2a27,0x2ac0,0x2b5a,0x2bf5,0x2c91,
-	0x2d2d,0x2dca,0x2e69,0x2f08,0x2fa8,0x3048,0x30ea,0x318c,
-	0x322f,0x32d3,0x3378,0x341d,0x34c3,0x356a,0x3612,0x36ba,
-	0x3764,0x380d,0x38b8,0x3963,0x3a10,0x3abc,0x3b6a,0x3c18,
-	0x3cc7,0x3d76,0x3e27,0x3ed7,0x3f89,0x403b,0x40ee,0x41a2,
-	0x4256,0x430a,0x43c0,0x4476,0x452c,0x45e3,0x469b,0x4753,
-	0x480c,0x48c6,0x4980,0x4a3a,0x4af5,0x4bb1,0x4c6d,0x4d2a,
-	0x4de7,0x4ea5,0x4f63,0x5022,0x50e1,0x51a1,0x5261,0x5321,
-	0x53e2,0x54a4,0x5566,0x5628,0x56eb,0x57ae,0x5872,0x5936,
-	0x59fa,0x5abf,0x5b84,0x5c4a,0x5d10,0x5dd6,0x5e9c,0x5f63,
-	0x602b,0x60f2,0x61ba,0x6282,0x634b,0x6413,0x64dd,0x65a6,
-	0x6670,0x6739,0x6803,0x68ce,0x6998,0x6a63,0x6b2e,0x6bfa,
-	0x6cc5,0x6d91,0x6e5c,0x6f28,0x6ff5,0x70c1,0x718d,0x725a,
-	0x7327,0x73f4,0x74c1,0x758e,0x765b,0x7729,0x77f6,0x78c4,
-	0x7991,0x7a5f,0x7b2c,0x7bfa,0x7cc8,0x7d96,0x7e64,0x7f32,
+/** Operations on the sine waveform for the waveform manager. */
+waveform_ops_t const sine_wave_ops = {
+	.init = sine_init,
+	.set = sine_set,
+	.get = sine_get,
 };
 
-static void sine_run(void const *arg)
+// the quarter table has 2^SINE_QUARTER_BITS steps
+#define SINE_QUARTER_BITS 8
+#define SINE_QUARTER_SZ (1 << SINE_QUARTER_BITS)
+/**
+ * sine lookup table, first quarter period scaled to 0-0xFFFF
+ * the rest of the period is folded onto it by symmetry, the extra entry
+ * at the end is the peak so the last step can be interpolated
+ */
+static uint16_t const sine_quarter_lookup[SINE_QUARTER_SZ + 1] = {
+	0x0000,0x0192,0x0324,0x04b6,0x0648,0x07da,0x096c,0x0afe,
+	0x0c90,0x0e21,0x0fb3,0x1144,0x12d5,0x1466,0x15f7,0x1787,
+	0x1918,0x1aa8,0x1c37,0x1dc7,0x1f56,0x20e5,0x2274,0x2402,
+	0x2590,0x271e,0x28ab,0x2a38,0x2bc4,0x2d50,0x2edc,0x3067,
+	0x31f1,0x337b,0x3505,0x368e,0x3817,0x399f,0x3b26,0x3cad,
+	0x3e34,0x3fb9,0x413f,0x42c3,0x4447,0x45ca,0x474d,0x48cf,
+	0x4a50,0x4bd0,0x4d50,0x4ecf,0x504d,0x51cb,0x5347,0x54c3,
+	0x563e,0x57b8,0x5932,0x5aaa,0x5c22,0x5d98,0x5f0e,0x6083,
+	0x61f7,0x636a,0x64dc,0x664d,0x67bd,0x692d,0x6a9b,0x6c08,
+	0x6d74,0x6edf,0x7049,0x71b2,0x7319,0x7480,0x75e5,0x774a,
+	0x78ad,0x7a0f,0x7b70,0x7cd0,0x7e2e,0x7f8b,0x80e7,0x8242,
+	0x839c,0x84f4,0x864b,0x87a1,0x88f5,0x8a48,0x8b9a,0x8cea,
+	0x8e39,0x8f87,0x90d3,0x921e,0x9368,0x94b0,0x95f6,0x973b,
+	0x987f,0x99c1,0x9b02,0x9c41,0x9d7f,0x9ebb,0x9ff6,0xa12f,
+	0xa267,0xa39d,0xa4d2,0xa604,0xa736,0xa865,0xa993,0xaac0,
+	0xabeb,0xad14,0xae3b,0xaf61,0xb085,0xb1a7,0xb2c8,0xb3e7,
+	0xb504,0xb620,0xb739,0xb851,0xb968,0xba7c,0xbb8e,0xbc9f,
+	0xbdae,0xbebb,0xbfc7,0xc0d0,0xc1d8,0xc2dd,0xc3e1,0xc4e3,
+	0xc5e3,0xc6e1,0xc7de,0xc8d8,0xc9d0,0xcac7,0xcbbb,0xccae,
+	0xcd9e,0xce8d,0xcf79,0xd064,0xd14c,0xd233,0xd317,0xd3fa,
+	0xd4da,0xd5b9,0xd695,0xd76f,0xd847,0xd91e,0xd9f2,0xdac3,
+	0xdb93,0xdc61,0xdd2c,0xddf6,0xdebd,0xdf82,0xe045,0xe106,
+	0xe1c5,0xe281,0xe33b,0xe3f4,0xe4a9,0xe55d,0xe60f,0xe6be,
+	0xe76b,0xe816,0xe8be,0xe965,0xea09,0xeaab,0xeb4a,0xebe7,
+	0xec82,0xed1b,0xedb2,0xee46,0xeed8,0xef67,0xeff5,0xf07f,
+	0xf108,0xf18e,0xf212,0xf294,0xf313,0xf390,0xf40b,0xf483,
+	0xf4f9,0xf56d,0xf5de,0xf64d,0xf6b9,0xf723,0xf78b,0xf7f0,
+	0xf853,0xf8b4,0xf912,0xf96d,0xf9c7,0xfa1e,0xfa72,0xfac4,
+	0xfb14,0xfb61,0xfbac,0xfbf4,0xfc3a,0xfc7e,0xfcbf,0xfcfd,
+	0xfd3a,0xfd73,0xfdab,0xfde0,0xfe12,0xfe42,0xfe70,0xfe9b,
+	0xfec3,0xfeea,0xff0d,0xff2f,0xff4d,0xff6a,0xff84,0xff9b,
+	0xffb0,0xffc3,0xffd3,0xffe0,0xffeb,0xfff4,0xfffa,0xfffe,
+	0xffff,
+};
+
+static inline uint16_t sine_sample(sine_state_t const *state, uint32_t curPhase)
 {
-	// lock access to shared state
-	osMutexWait(M_sine_state, osWaitForever);
-	{
-		sine_state_t const *state = arg;
+	// fold the phase onto the quarter table, then scale to the input amplitude
+	return dds_scale(dds_sine_quarter(sine_quarter_lookup, SINE_QUARTER_BITS, curPhase), state->ampScale);
+}
 
-		// if period has elapsed, wrap back around to 0
-		if (curTimeMs >= state->periodMs) {
-			curTimeMs = 0;
-		}
+static void sine_run(void const *arg, uint16_t *buf, uint16_t len)
+{
+	sine_state_t const *state = arg;
 
-		// calculate the index in the lookup table, which has period 1000
-		uint16_t idx = (uint32_t)curTimeMs * SINE_LOOKUP_SZ / state->periodMs;
-		// output the amplitude from the lookup table, scaled to the input amplitude
-		GPIO_Write(WAVEFORM_PORT, (uint32_t)state->amplitude * sine_lookup[idx] / 0xFFFF);
+	for (uint16_t i = 0; i < len; ++i) {
+		// step the phase, the accumulator wraps around at the end of each period
+		buf[i] = sine_sample(state, dds_next(&phase, state->tuningWord));
 	}
-	osMutexRelease(M_sine_state);
-
-	++curTimeMs;
 }
@@ -0,0 +1,80 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Lock-free snapshot of a small struct, published by one writer thread and
+ * read from anywhere, including interrupts.
+ * The value is double-buffered: a publish writes the slot readers aren't using,
+ * then flips the sequence counter, which selects the current slot. The counter is
+ * odd while a publish is in progress, so a reader can tell if a writer lapped it.
+ * A reader that preempts the writer always gets a consistent copy without waiting.
+ */
+
+#pragma once
+
+#include "stm32f10x.h"
+#include <stdint.h>
+#include <string.h>
+
+/** Max size of a value held in a snapshot, a multiple of 4. */
+#define SNAPSHOT_MAX_SZ	24
+
+/** Fails the build if a type is too big for a snapshot, put it next to every type that's published. */
+#define SNAPSHOT_CHECK_SIZE(type) \
+	_Static_assert(sizeof(type) <= SNAPSHOT_MAX_SZ, #type " doesn't fit in a snapshot, raise SNAPSHOT_MAX_SZ")
+
+/** A double-buffered value with a sequence counter. */
+typedef struct _snapshot_t {
+	/** Sequence counter, incremented at the start and end of each publish */
+	volatile uint32_t seq;
+	/** Size of the value */
+	uint8_t size;
+	/** The two copies of the value, (seq >> 1) & 1 is the current one */
+	uint32_t slots[2][SNAPSHOT_MAX_SZ / 4];
+} snapshot_t;
+
+/** Publishes a new value, readers see either the old or the new value in full. */
+static inline void snapshot_publish(snapshot_t *snap, void const *value, uint8_t size)
+{
+	uint32_t const seq = snap->seq;
+	// mark the publish in progress, then fill the slot readers aren't using
+	snap->seq = seq + 1;
+	__DMB();
+	memcpy(snap->slots[((seq >> 1) + 1) & 1], value, size);
+	snap->size = size;
+	__DMB();
+	// make the new slot current
+	snap->seq = seq + 2;
+}
+
+/**
+ * Copies the current value, never waits.
+ * Returns 0 if a writer lapped the reader and overwrote the slot during the copy.
+ */
+static inline uint8_t snapshot_try_read(snapshot_t const *snap, void *value)
+{
+	uint32_t const seq = snap->seq;
+	__DMB();
+	// the current slot doesn't change until a publish completes
+	memcpy(value, snap->slots[(seq >> 1) & 1], snap->size);
+	__DMB();
+	// the slot is only overwritten by the publish after the next one
+	return (snap->seq - (seq & ~1UL)) <= 2;
+}
+
+/**
+ * Returns non-zero if a publish is in progress.
+ * A reader that preempted the writer then gets the value from before that publish.
+ */
+static inline uint8_t snapshot_publishing(snapshot_t const *snap)
+{
+	return snap->seq & 1;
+}
+
+/** Copies the current value, retrying until the copy is consistent. */
+static inline void snapshot_read(snapshot_t const *snap, void *value)
+{
+	while (!snapshot_try_read(snap, value));
+}
@@ -0,0 +1,64 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "stack_watch.h"
+#include <stddef.h>
+
+// bottom word of each thread stack, NULL until the thread registers
+static uint32_t const *volatile bottoms[STACK_WATCH_NUM_THREADS];
+
+// names of the threads, in the order of stack_watch_thread_t
+static char const *const threadNames[STACK_WATCH_NUM_THREADS] = {
+	[STACK_WATCH_IDLE] = "idle",
+	[STACK_WATCH_UART] = "uart",
+	[STACK_WATCH_WAVEFORM] = "waveform",
+};
+
+#ifdef STACK_WATCH_HOST
+void stack_watch_register(stack_watch_thread_t thread)
+{
+	// the host stacks aren't painted, the simulation sets the bottom of the ones it paints itself
+}
+
+void stack_watch_set_bottom(stack_watch_thread_t thread, uint32_t const *bottom)
+{
+	bottoms[thread] = bottom;
+}
+#else
+void stack_watch_register(stack_watch_thread_t thread)
+{
+	// a local lives on the calling thread's stack, everything below it down to the bottom word is paint
+	uint32_t marker = 0;
+	uint32_t const *word = &marker;
+	for (uint32_t i = 0; i < STACK_WATCH_MAX_WORDS; ++i, --word) {
+		if (*word == STACK_WATCH_BOTTOM) {
+			bottoms[thread] = word;
+			return;
+		}
+	}
+}
+#endif
+
+int32_t stack_watch_free_words(stack_watch_thread_t thread)
+{
+	uint32_t const *bottom = bottoms[thread];
+	if (bottom == NULL || *bottom != STACK_WATCH_BOTTOM) {
+		return -1;
+	}
+
+	// the stack grows down, so the paint that's left starts right above the bottom word
+	int32_t free = 0;
+	while (free < STACK_WATCH_MAX_WORDS && bottom[free + 1] == STACK_WATCH_PAINT) {
+		++free;
+	}
+	return free;
+}
+
+char const *stack_watch_name(stack_watch_thread_t thread)
+{
+	return threadNames[thread];
+}
@@ -0,0 +1,55 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Stack high-water marks for the RTX threads.
+ * RTX paints every thread stack with STACK_WATCH_PAINT when the thread is created
+ * (OS_STKINIT) and puts STACK_WATCH_BOTTOM in the lowest word to check for overflow
+ * (OS_STKCHECK). A thread registers itself when it starts, which finds the bottom
+ * of its stack, and the paint left above the bottom is the stack it has never used.
+ * Nothing here depends on RTX internals, so a host simulation gets the same report by
+ * running its threads on stacks painted the same way.
+ * Building with STACK_WATCH_HOST leaves out the search below the stack pointer, which
+ * would read past the end of a host stack, and the simulation gives each bottom instead.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/** Pattern RTX fills unused stack with. */
+#define STACK_WATCH_PAINT	0xCCCCCCCC
+/** Word RTX puts at the bottom of every thread stack. */
+#define STACK_WATCH_BOTTOM	0xE25A2EA5
+/** Furthest a thread can be from the bottom of its stack when it registers, in words. */
+#ifndef STACK_WATCH_MAX_WORDS
+#define STACK_WATCH_MAX_WORDS	256
+#endif
+
+/** The threads that are watched. */
+typedef enum _stack_watch_thread_t {
+	STACK_WATCH_IDLE,
+	STACK_WATCH_UART,
+	STACK_WATCH_WAVEFORM,
+
+	STACK_WATCH_NUM_THREADS,
+} stack_watch_thread_t;
+
+/**
+ * Finds the bottom of the calling thread's stack, call first thing in the thread.
+ * Must be called from the thread itself.
+ */
+void stack_watch_register(stack_watch_thread_t thread);
+/**
+ * Returns the number of words the thread has never used above the bottom of its stack,
+ * or -1 if the thread hasn't registered or its bottom word was overwritten.
+ */
+int32_t stack_watch_free_words(stack_watch_thread_t thread);
+#ifdef STACK_WATCH_HOST
+/** Sets the bottom word of a thread's painted stack, in place of stack_watch_register. */
+void stack_watch_set_bottom(stack_watch_thread_t thread, uint32_t const *bottom);
+#endif
+/** Returns the name of a thread. */
+char const *stack_watch_name(stack_watch_thread_t thread);
@@ -0,0 +1,228 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * The firmware on the host, with USART1 wired to a pseudo-terminal, for test_cmd_link.py.
+ * The UART thread runs the menus and the command link as on the target, and the waveform
+ * thread applies what they send to the waveforms, over the simulated peripherals.
+ * While the UART thread waits on a signal, characters from the pseudo-terminal are fed in
+ * through the simulated DMA1 channel 5 and the ones DMA1 channel 4 sends are written out.
+ * The waveform thread is higher priority, so sending it mail runs it until it's done.
+ * It runs on a painted stack, and how deep it went is printed when the harness exits.
+ *
+ * Usage: link_host FD, where FD is the master side of the pseudo-terminal.
+ * Exits once the other side is closed.
+ */
+
+#include "cmsis_os.h"
+#include "mock.h"
+#include "profile.h"
+#include "stack_watch.h"
+#include "uart_handler.h"
+#include "wave_out.h"
+#include "waveform.h"
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// characters fed in before the line goes idle, well under what the receive ring keeps
+#define RX_CHUNK	64
+// characters sent gathered into each write
+#define TX_CHUNK	256
+// a host thread needs far more stack than the target, STACK_WATCH_MAX_WORDS is set to match
+#define WAVEFORM_STACK_WORDS	4096
+
+// the UART thread, only its id is used
+static osThreadId const uartThread = (osThreadId)0x1000;
+static int32_t signals = 0;
+static int fd;
+
+// one message in flight, the waveform thread takes it before the sender carries on
+static pthread_mutex_t mailLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mailCond = PTHREAD_COND_INITIALIZER;
+static void *mail = NULL;
+static uint8_t bMailFree = 0;
+static waveform_msg_t mailSlot;
+
+// the waveform thread's stack, and a word of its first frame
+static uint32_t waveformStack[WAVEFORM_STACK_WORDS] __attribute__((aligned(64)));
+static uint32_t const *volatile waveformEntry;
+
+/** Prints how deep the waveform thread's stack went below its entry, the harness and libc use what's above. */
+static void report_stack(void)
+{
+	int32_t const free = stack_watch_free_words(STACK_WATCH_WAVEFORM);
+	if (free < 0 || waveformEntry == NULL) {
+		fprintf(stderr, "waveform thread stack: unknown\n");
+		return;
+	}
+	uint32_t const *const lowest = waveformStack + 1 + free;
+	fprintf(stderr, "waveform thread stack: %u bytes used below waveform_thread on this host\n",
+		(unsigned)((waveformEntry - lowest) * sizeof(uint32_t)));
+}
+
+/** Writes what DMA1 channel 4 sends to the pseudo-terminal. */
+static void pump_tx(void)
+{
+	char out[TX_CHUNK];
+	uint32_t len = 0;
+	mock_irq_run();
+	while (mock_dma_request(4)) {
+		out[len++] = (char)USART1->DR;
+		mock_irq_run();
+		if (len == sizeof(out)) {
+			write(fd, out, len);
+			len = 0;
+		}
+	}
+	if (len != 0) {
+		write(fd, out, len);
+	}
+}
+
+/** Feeds what the pseudo-terminal sent through DMA1 channel 5, then idles the line. Waits up to timeout ms for it. */
+static void pump_rx(int timeout)
+{
+	struct pollfd pfd = { fd, POLLIN, 0 };
+	if (poll(&pfd, 1, timeout) <= 0) {
+		return;
+	}
+	char in[RX_CHUNK];
+	ssize_t const len = read(fd, in, sizeof(in));
+	if (len <= 0) {
+		// the other side closed the pseudo-terminal
+		report_stack();
+		exit(0);
+	}
+	for (ssize_t i = 0; i < len; ++i) {
+		USART1->DR = (uint8_t)in[i];
+		mock_dma_request(5);
+		mock_irq_run();
+	}
+	USART1->SR |= USART_SR_IDLE;
+	NVIC->ISPR[USART1_IRQn / 32] |= 1UL << (USART1_IRQn % 32);
+	mock_irq_run();
+	USART1->SR &= ~USART_SR_IDLE;
+}
+
+osThreadId osThreadGetId(void)
+{
+	return uartThread;
+}
+
+int32_t osSignalSet(osThreadId thread_id, int32_t set)
+{
+	int32_t const prev = signals;
+	signals |= set;
+	return prev;
+}
+
+int32_t osSignalClear(osThreadId thread_id, int32_t clear)
+{
+	int32_t const prev = signals;
+	signals &= ~clear;
+	return prev;
+}
+
+osEvent osSignalWait(int32_t wait, uint32_t millisec)
+{
+	// the line runs while the UART thread waits, for as long as it takes
+	while (!(signals & wait)) {
+		pump_tx();
+		if (!(signals & wait)) {
+			pump_rx(100);
+		}
+	}
+	osEvent event = { osEventSignal, { .signals = signals & wait } };
+	signals &= ~wait;
+	return event;
+}
+
+osMailQId osMailCreate(osMailQDef_t const *queue_def, osThreadId thread_id)
+{
+	return (osMailQId)&mailSlot;
+}
+
+void *osMailAlloc(osMailQId queue_id, uint32_t millisec)
+{
+	return &mailSlot;
+}
+
+osStatus osMailPut(osMailQId queue_id, void *msg)
+{
+	pthread_mutex_lock(&mailLock);
+	mail = msg;
+	bMailFree = 0;
+	pthread_cond_broadcast(&mailCond);
+	// the waveform thread preempts the sender until it's done with the message
+	while (!bMailFree) {
+		pthread_cond_wait(&mailCond, &mailLock);
+	}
+	pthread_mutex_unlock(&mailLock);
+	return osOK;
+}
+
+osEvent osMailGet(osMailQId queue_id, uint32_t millisec)
+{
+	pthread_mutex_lock(&mailLock);
+	while (mail == NULL) {
+		pthread_cond_wait(&mailCond, &mailLock);
+	}
+	osEvent event = { osEventMail, { .p = mail } };
+	mail = NULL;
+	pthread_mutex_unlock(&mailLock);
+	return event;
+}
+
+osStatus osMailFree(osMailQId queue_id, void *msg)
+{
+	pthread_mutex_lock(&mailLock);
+	bMailFree = 1;
+	pthread_cond_broadcast(&mailCond);
+	pthread_mutex_unlock(&mailLock);
+	return osOK;
+}
+
+static void *run_waveform_thread(void *arg)
+{
+	uint32_t entry = 0;
+	waveformEntry = &entry;
+	waveform_thread(NULL);
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s FD\n", argv[0]);
+		return 2;
+	}
+	fd = atoi(argv[1]);
+
+	// the same setup as main.c
+	mock_reset();
+	profile_init();
+	wave_out_init();
+	uart_handler_init();
+	waveform_init();
+	mock_sync();
+
+	// painted the way RTX paints a thread stack
+	for (uint32_t i = 0; i < WAVEFORM_STACK_WORDS; ++i) {
+		waveformStack[i] = STACK_WATCH_PAINT;
+	}
+	waveformStack[0] = STACK_WATCH_BOTTOM;
+	stack_watch_set_bottom(STACK_WATCH_WAVEFORM, waveformStack);
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setstack(&attr, waveformStack, sizeof(waveformStack));
+	pthread_t waveformThread;
+	pthread_create(&waveformThread, &attr, run_waveform_thread, NULL);
+	uart_handler_thread(NULL);
+	return 0;
+}
@@ -0,0 +1,362 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "mock.h"
+#include <string.h>
+
+TIM_TypeDef mock_tim[5];
+DMA_Channel_TypeDef mock_dma_ch[8];
+DMA_TypeDef mock_dma1;
+USART_TypeDef mock_usart1;
+RCC_TypeDef mock_rcc;
+GPIO_TypeDef mock_gpio[3];
+AFIO_TypeDef mock_afio;
+CRC_TypeDef mock_crc;
+DBGMCU_TypeDef mock_dbgmcu;
+NVIC_Type mock_nvic;
+DWT_Type mock_dwt;
+CoreDebug_Type mock_core_debug;
+uint32_t SystemCoreClock = 72000000;
+
+uint64_t mock_clock = 0;
+void (*mock_barrier_hook)(void) = NULL;
+void (*mock_wfi_hook)(void) = NULL;
+
+/** What a timer holds that software can't read. */
+typedef struct {
+	/** Prescaler and auto-reload in effect, loaded from PSC and ARR on an update */
+	uint32_t psc;
+	uint32_t arr;
+	/** Compare value in effect, loaded from CCR1 on an update when it's preloaded */
+	uint32_t ccr1;
+} tim_shadow_t;
+
+/** What a DMA channel holds that software can't read. */
+typedef struct {
+	/** Non-zero while enabled, to catch it being enabled */
+	uint8_t bEnabled;
+	/** Transfer count and addresses it was enabled with, a circular transfer goes back to them */
+	uint32_t len;
+	uint32_t periph;
+	uint32_t mem;
+	/** Current addresses */
+	uint32_t periphNext;
+	uint32_t memNext;
+	/** Items moved since it was enabled */
+	uint32_t moved;
+	/** Items left after the last move, CNDTR can only change while disabled so anything else was a restart */
+	uint32_t left;
+} dma_shadow_t;
+
+static tim_shadow_t timShadow[5];
+static dma_shadow_t dmaShadow[8];
+
+// DMA1 channels requested by each timer's update and capture/compare 1 events, 0 if none
+static uint8_t const timUpdateDma[5] = { [2] = 2, [3] = 3, [4] = 7 };
+static uint8_t const timCc1Dma[5] = { [2] = 5, [3] = 6, [4] = 1 };
+
+// handlers the firmware under test may not define
+#define WEAK_HANDLER(name) void name(void) __attribute__((weak)); void name(void) {}
+WEAK_HANDLER(DMA1_Channel1_IRQHandler)
+WEAK_HANDLER(DMA1_Channel2_IRQHandler)
+WEAK_HANDLER(DMA1_Channel3_IRQHandler)
+WEAK_HANDLER(DMA1_Channel4_IRQHandler)
+WEAK_HANDLER(DMA1_Channel5_IRQHandler)
+WEAK_HANDLER(DMA1_Channel6_IRQHandler)
+WEAK_HANDLER(DMA1_Channel7_IRQHandler)
+WEAK_HANDLER(TIM2_IRQHandler)
+WEAK_HANDLER(TIM3_IRQHandler)
+WEAK_HANDLER(TIM4_IRQHandler)
+WEAK_HANDLER(USART1_IRQHandler)
+
+/** An interrupt and its handler. */
+typedef struct {
+	IRQn_Type irq;
+	void (*handler)(void);
+} vector_t;
+
+static vector_t const vectors[] = {
+	{ DMA1_Channel1_IRQn, DMA1_Channel1_IRQHandler },
+	{ DMA1_Channel2_IRQn, DMA1_Channel2_IRQHandler },
+	{ DMA1_Channel3_IRQn, DMA1_Channel3_IRQHandler },
+	{ DMA1_Channel4_IRQn, DMA1_Channel4_IRQHandler },
+	{ DMA1_Channel5_IRQn, DMA1_Channel5_IRQHandler },
+	{ DMA1_Channel6_IRQn, DMA1_Channel6_IRQHandler },
+	{ DMA1_Channel7_IRQn, DMA1_Channel7_IRQHandler },
+	{ TIM2_IRQn, TIM2_IRQHandler },
+	{ TIM3_IRQn, TIM3_IRQHandler },
+	{ TIM4_IRQn, TIM4_IRQHandler },
+	{ USART1_IRQn, USART1_IRQHandler },
+};
+
+void GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init)
+{
+	(void)port;
+	(void)init;
+}
+
+void GPIO_Write(GPIO_TypeDef *port, uint16_t value)
+{
+	port->ODR = value;
+}
+
+void mock_reset(void)
+{
+	memset(mock_tim, 0, sizeof(mock_tim));
+	memset(mock_dma_ch, 0, sizeof(mock_dma_ch));
+	memset(&mock_dma1, 0, sizeof(mock_dma1));
+	memset(&mock_usart1, 0, sizeof(mock_usart1));
+	memset(&mock_rcc, 0, sizeof(mock_rcc));
+	memset(mock_gpio, 0, sizeof(mock_gpio));
+	memset(&mock_crc, 0, sizeof(mock_crc));
+	memset(&mock_nvic, 0, sizeof(mock_nvic));
+	memset(timShadow, 0, sizeof(timShadow));
+	memset(dmaShadow, 0, sizeof(dmaShadow));
+	mock_usart1.SR = USART_SR_TXE | USART_SR_TC;
+	mock_clock = 0;
+}
+
+/** Sets the pending bit of irq. */
+static void irq_pend(IRQn_Type irq)
+{
+	mock_nvic.ISPR[irq / 32] |= 1UL << (irq % 32);
+}
+
+void mock_sync(void)
+{
+	// clearing a channel's global flag clears all of its flags
+	uint32_t clear = mock_dma1.IFCR;
+	for (int n = 0; n < 7; ++n) {
+		if (clear & (1UL << (4 * n))) {
+			clear |= 0xFUL << (4 * n);
+		}
+	}
+	mock_dma1.ISR &= ~clear;
+	mock_dma1.IFCR = 0;
+	for (int i = 0; i < 8; ++i) {
+		mock_nvic.ISER[i] &= ~mock_nvic.ICER[i];
+		mock_nvic.ICER[i] = 0;
+		mock_nvic.ISPR[i] &= ~mock_nvic.ICPR[i];
+		mock_nvic.ICPR[i] = 0;
+	}
+
+	// catch channels being enabled and disabled
+	for (int n = 1; n < 8; ++n) {
+		DMA_Channel_TypeDef *ch = &mock_dma_ch[n];
+		dma_shadow_t *shadow = &dmaShadow[n];
+		uint8_t const bEnabled = (ch->CCR & DMA_CCR1_EN) != 0;
+		// disabled and enabled again since the last step, it starts over from the new registers
+		uint8_t const bRestarted = shadow->bEnabled
+			&& (ch->CNDTR != shadow->left || ch->CMAR != shadow->mem || ch->CPAR != shadow->periph);
+		if (bEnabled && (!shadow->bEnabled || bRestarted)) {
+			shadow->len = ch->CNDTR;
+			shadow->periph = shadow->periphNext = ch->CPAR;
+			shadow->mem = shadow->memNext = ch->CMAR;
+			shadow->moved = 0;
+			shadow->left = ch->CNDTR;
+		}
+		shadow->bEnabled = bEnabled;
+	}
+}
+
+/** Sets flags in DMA1 ISR for channel n, pending its interrupt if any enabled one is set. */
+static void dma_flag(uint8_t n, uint32_t flags, uint32_t enabled)
+{
+	mock_dma1.ISR |= (flags | 1) << (4 * (n - 1));
+	if (flags & enabled) {
+		irq_pend(DMA1_Channel1_IRQn + n - 1);
+	}
+}
+
+/** Reads a size bytes item, size being the CCR size field. */
+static uint32_t dma_load(uint32_t addr, uint32_t size)
+{
+	void const *p = (void const *)(uintptr_t)addr;
+	switch (size) {
+		case 0:
+			return *(uint8_t const volatile *)p;
+		case 1:
+			return *(uint16_t const volatile *)p;
+		default:
+			return *(uint32_t const volatile *)p;
+	}
+}
+
+/** Writes an item, truncated to the CCR size field. */
+static void dma_store(uint32_t addr, uint32_t size, uint32_t value)
+{
+	void *p = (void *)(uintptr_t)addr;
+	switch (size) {
+		case 0:
+			*(uint8_t volatile *)p = value;
+			break;
+		case 1:
+			*(uint16_t volatile *)p = value;
+			break;
+		default:
+			*(uint32_t volatile *)p = value;
+			break;
+	}
+}
+
+uint8_t mock_dma_request(uint8_t n)
+{
+	mock_sync();
+	DMA_Channel_TypeDef *ch = &mock_dma_ch[n];
+	dma_shadow_t *shadow = &dmaShadow[n];
+	if (!shadow->bEnabled || ch->CNDTR == 0) {
+		return 0;
+	}
+
+	uint32_t const ccr = ch->CCR;
+	uint32_t const psize = (ccr >> 8) & 3;
+	uint32_t const msize = (ccr >> 10) & 3;
+	if (ccr & DMA_CCR1_DIR) {
+		dma_store(shadow->periphNext, psize, dma_load(shadow->memNext, msize));
+	} else {
+		dma_store(shadow->memNext, msize, dma_load(shadow->periphNext, psize));
+	}
+	if (ccr & DMA_CCR1_PINC) {
+		shadow->periphNext += 1 << psize;
+	}
+	if (ccr & DMA_CCR1_MINC) {
+		shadow->memNext += 1 << msize;
+	}
+	++shadow->moved;
+
+	uint32_t const left = --ch->CNDTR;
+	uint32_t const enabled = ((ccr & DMA_CCR1_TCIE) ? 2 : 0) | ((ccr & DMA_CCR1_HTIE) ? 4 : 0);
+	if (left == shadow->len / 2) {
+		dma_flag(n, 4, enabled);
+	}
+	if (left == 0) {
+		dma_flag(n, 2, enabled);
+		if (ccr & DMA_CCR1_CIRC) {
+			ch->CNDTR = shadow->len;
+			shadow->periphNext = shadow->periph;
+			shadow->memNext = shadow->mem;
+		}
+	}
+	shadow->left = ch->CNDTR;
+	return 1;
+}
+
+uint32_t mock_dma_moved(uint8_t n)
+{
+	return dmaShadow[n].moved;
+}
+
+/** An update event on timer n, from an overflow or UG. */
+static uint8_t tim_update(uint8_t n, uint8_t bOverflow)
+{
+	TIM_TypeDef *tim = &mock_tim[n];
+	tim_shadow_t *shadow = &timShadow[n];
+	if (tim->CR1 & TIM_CR1_UDIS) {
+		return 0;
+	}
+	shadow->psc = tim->PSC;
+	shadow->arr = tim->ARR;
+	shadow->ccr1 = tim->CCR1;
+	// with URS set only an overflow sets the flag and requests DMA
+	if (bOverflow || !(tim->CR1 & TIM_CR1_URS)) {
+		tim->SR |= TIM_SR_UIF;
+		if ((tim->DIER & TIM_DIER_UIE)) {
+			irq_pend(TIM2_IRQn + n - 2);
+		}
+		if ((tim->DIER & TIM_DIER_UDE) && timUpdateDma[n]) {
+			mock_dma_request(timUpdateDma[n]);
+		}
+	}
+	return MOCK_TIM_UPDATE;
+}
+
+uint8_t mock_tim_step(uint8_t n)
+{
+	mock_sync();
+	TIM_TypeDef *tim = &mock_tim[n];
+	tim_shadow_t *shadow = &timShadow[n];
+	uint8_t events = 0;
+	if (tim->EGR & TIM_EGR_UG) {
+		tim->EGR = 0;
+		tim->CNT = 0;
+		// the update happens when UG is written, before the counter moves again
+		return tim_update(n, 0);
+	}
+	if (!(tim->CR1 & TIM_CR1_CEN)) {
+		return events;
+	}
+
+	mock_clock += shadow->psc + 1;
+	// ARR is used straight away unless it's preloaded
+	uint32_t const arr = (tim->CR1 & TIM_CR1_ARPE) ? shadow->arr : tim->ARR;
+	if (tim->CNT >= arr) {
+		tim->CNT = 0;
+		events |= tim_update(n, 1);
+	} else {
+		++tim->CNT;
+	}
+
+	uint32_t const ccr1 = (tim->CCMR1 & TIM_CCMR1_OC1PE) ? shadow->ccr1 : tim->CCR1;
+	if (tim->CNT == ccr1) {
+		tim->SR |= TIM_SR_CC1IF;
+		events |= MOCK_TIM_CC1;
+		if ((tim->DIER & TIM_DIER_CC1IE)) {
+			irq_pend(TIM2_IRQn + n - 2);
+		}
+		if ((tim->DIER & TIM_DIER_CC1DE) && timCc1Dma[n]) {
+			mock_dma_request(timCc1Dma[n]);
+		}
+	}
+	return events;
+}
+
+uint32_t mock_tim_until_update(uint8_t n)
+{
+	uint64_t const start = mock_clock;
+	TIM_TypeDef *tim = &mock_tim[n];
+	tim_shadow_t *shadow = &timShadow[n];
+	while (tim->CR1 & TIM_CR1_CEN) {
+		// nothing happens on the ticks before the next compare or overflow, skip straight past them
+		uint32_t const arr = (tim->CR1 & TIM_CR1_ARPE) ? shadow->arr : tim->ARR;
+		uint32_t const ccr1 = (tim->CCMR1 & TIM_CCMR1_OC1PE) ? shadow->ccr1 : tim->CCR1;
+		uint32_t const next = (ccr1 > tim->CNT && ccr1 <= arr) ? ccr1 - 1 : arr;
+		if (!(tim->EGR & TIM_EGR_UG) && tim->CNT < next) {
+			mock_clock += (uint64_t)(next - tim->CNT) * (shadow->psc + 1);
+			tim->CNT = next;
+		}
+		if (mock_tim_step(n) & MOCK_TIM_UPDATE) {
+			return mock_clock - start;
+		}
+	}
+	return 0;
+}
+
+uint8_t mock_irq_pending(IRQn_Type irq)
+{
+	mock_sync();
+	uint32_t const bit = 1UL << (irq % 32);
+	return (mock_nvic.ISPR[irq / 32] & mock_nvic.ISER[irq / 32] & bit) != 0;
+}
+
+uint32_t mock_irq_run(void)
+{
+	uint32_t count = 0;
+	uint8_t bRan = 1;
+	while (bRan) {
+		bRan = 0;
+		for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); ++i) {
+			IRQn_Type const irq = vectors[i].irq;
+			if (mock_irq_pending(irq)) {
+				mock_nvic.ISPR[irq / 32] &= ~(1UL << (irq % 32));
+				vectors[i].handler();
+				++count;
+				bRan = 1;
+			}
+		}
+	}
+	return count;
+}
@@ -0,0 +1,59 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Simulated peripherals for the host tests.
+ * The registers in stubs/stm32f10x.h are plain memory, these functions make the
+ * timers, DMA1 and the NVIC act on them the way the hardware would, one step at a time.
+ * Writes the firmware made to clear-on-write registers (DMA IFCR, NVIC ICER and ICPR)
+ * take effect at the start of the next step, a channel's CGIF bit clears all of its flags.
+ * A DMA channel disabled, rewritten and enabled again between steps starts over.
+ * mock_barrier_hook, declared with __DMB, runs at every barrier so a test can preempt
+ * the code under test there, and mock_wfi_hook, declared with __WFI, stands in for a sleep.
+ *
+ * Peripheral addresses are kept in 32-bit registers, so the tests are linked
+ * without PIE to keep the firmware's buffers in the low 4 GB.
+ */
+
+#pragma once
+
+#include "stm32f10x.h"
+#include <stdint.h>
+
+/** Events a timer step can return. */
+#define MOCK_TIM_UPDATE	0x01
+#define MOCK_TIM_CC1	0x02
+
+/** Timer clocks since the test started, advanced by the timer steps. */
+extern uint64_t mock_clock;
+
+/** Returns all the simulated peripherals to their reset state. */
+void mock_reset(void);
+/** Applies the firmware's writes to the clear-on-write registers. */
+void mock_sync(void);
+
+/**
+ * Advances timer n to its next counter tick, (PSC + 1) timer clocks if it's running.
+ * Processes a pending UG first. Update and capture/compare 1 events request the
+ * DMA1 channels the timer is wired to, when DIER enables them.
+ * Returns the MOCK_TIM_* events of the step.
+ */
+uint8_t mock_tim_step(uint8_t n);
+/** Steps timer n until an update event, returns the timer clocks it took, or 0 if it isn't running. */
+uint32_t mock_tim_until_update(uint8_t n);
+
+/**
+ * Handles one request on DMA1 channel n, moving one item if the channel is enabled and has any left.
+ * Sets the channel's flags, and pends its interrupt if it's enabled for them.
+ * Returns non-zero if an item was moved.
+ */
+uint8_t mock_dma_request(uint8_t n);
+/** Number of items channel n has moved since it was last enabled. */
+uint32_t mock_dma_moved(uint8_t n);
+
+/** Returns non-zero if irq is pending and enabled. */
+uint8_t mock_irq_pending(IRQn_Type irq);
+/** Runs the handlers of the pending and enabled interrupts, until none are left. Returns the number run. */
+uint32_t mock_irq_run(void);
@@ -0,0 +1,84 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Host stand-in for the CMSIS-RTOS header, for the tests.
+ * Only the types and macros are here. A test that runs firmware calling into the
+ * RTOS defines the functions it needs, with whatever behaviour it's testing.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define osWaitForever	0xFFFFFFFF
+
+typedef enum {
+	osOK = 0,
+	osEventSignal = 0x08,
+	osEventMessage = 0x10,
+	osEventMail = 0x20,
+	osEventTimeout = 0x40,
+	osErrorParameter = 0x80,
+	osErrorResource = 0x81,
+} osStatus;
+
+typedef enum {
+	osPriorityIdle = -3,
+	osPriorityLow = -2,
+	osPriorityBelowNormal = -1,
+	osPriorityNormal = 0,
+	osPriorityAboveNormal = 1,
+	osPriorityHigh = 2,
+	osPriorityRealtime = 3,
+} osPriority;
+
+typedef struct os_thread_cb *osThreadId;
+typedef struct os_mailQ_cb *osMailQId;
+typedef void (*os_pthread)(void const *argument);
+
+typedef struct {
+	osStatus status;
+	union {
+		uint32_t v;
+		void *p;
+		int32_t signals;
+	} value;
+} osEvent;
+
+typedef struct {
+	os_pthread pthread;
+	osPriority tpriority;
+	uint32_t instances;
+	uint32_t stacksize;
+} osThreadDef_t;
+
+typedef struct {
+	uint32_t queue_sz;
+	uint32_t item_sz;
+	void *pool;
+} osMailQDef_t;
+
+#define osThreadDef(name, priority, instances, stacksz) \
+	const osThreadDef_t os_thread_def_##name = { (name), (priority), (instances), (stacksz) }
+#define osThread(name)	&os_thread_def_##name
+
+#define osMailQDef(name, queue_sz, type) \
+	const osMailQDef_t os_mailQ_def_##name = { (queue_sz), sizeof(type), NULL }
+#define osMailQ(name)	&os_mailQ_def_##name
+
+osStatus osKernelInitialize(void);
+osStatus osKernelStart(void);
+osThreadId osThreadCreate(osThreadDef_t const *thread_def, void *argument);
+osThreadId osThreadGetId(void);
+int32_t osSignalSet(osThreadId thread_id, int32_t signals);
+int32_t osSignalClear(osThreadId thread_id, int32_t signals);
+osEvent osSignalWait(int32_t signals, uint32_t millisec);
+osMailQId osMailCreate(osMailQDef_t const *queue_def, osThreadId thread_id);
+void *osMailAlloc(osMailQId queue_id, uint32_t millisec);
+osStatus osMailPut(osMailQId queue_id, void *mail);
+osEvent osMailGet(osMailQId queue_id, uint32_t millisec);
+osStatus osMailFree(osMailQId queue_id, void *mail);
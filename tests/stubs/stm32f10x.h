@@ -0,0 +1,249 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Host stand-in for the device header, for the tests.
+ * Each peripheral the firmware uses is a plain struct in RAM, with the register names
+ * and bit positions of the STM32F103. Nothing happens when a register is written,
+ * the hardware behaviour the tests rely on is simulated by mock.c when they ask for it.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define __IO	volatile
+
+typedef enum IRQn {
+	DMA1_Channel1_IRQn = 11,
+	DMA1_Channel2_IRQn = 12,
+	DMA1_Channel3_IRQn = 13,
+	DMA1_Channel4_IRQn = 14,
+	DMA1_Channel5_IRQn = 15,
+	DMA1_Channel6_IRQn = 16,
+	DMA1_Channel7_IRQn = 17,
+	TIM2_IRQn = 28,
+	TIM3_IRQn = 29,
+	TIM4_IRQn = 30,
+	USART1_IRQn = 37,
+} IRQn_Type;
+
+#define __NVIC_PRIO_BITS	4
+
+typedef struct {
+	__IO uint32_t CR1, CR2, SMCR, DIER, SR, EGR, CCMR1, CCMR2, CCER, CNT, PSC, ARR, RCR;
+	__IO uint32_t CCR1, CCR2, CCR3, CCR4, BDTR, DCR, DMAR;
+} TIM_TypeDef;
+
+typedef struct {
+	__IO uint32_t CCR, CNDTR, CPAR, CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct {
+	__IO uint32_t ISR, IFCR;
+} DMA_TypeDef;
+
+typedef struct {
+	__IO uint32_t SR, DR, BRR, CR1, CR2, CR3, GTPR;
+} USART_TypeDef;
+
+typedef struct {
+	__IO uint32_t CR, CFGR, CIR, APB2RSTR, APB1RSTR, AHBENR, APB2ENR, APB1ENR, BDCR, CSR;
+} RCC_TypeDef;
+
+typedef struct {
+	__IO uint32_t CRL, CRH, IDR, ODR, BSRR, BRR, LCKR;
+} GPIO_TypeDef;
+
+typedef struct {
+	__IO uint32_t EVCR, MAPR, EXTICR[4];
+} AFIO_TypeDef;
+
+typedef struct {
+	__IO uint32_t DR, IDR, CR;
+} CRC_TypeDef;
+
+typedef struct {
+	__IO uint32_t IDCODE, CR;
+} DBGMCU_TypeDef;
+
+typedef struct {
+	__IO uint32_t ISER[8];
+	uint32_t reserved0[24];
+	__IO uint32_t ICER[8];
+	uint32_t reserved1[24];
+	__IO uint32_t ISPR[8];
+	uint32_t reserved2[24];
+	__IO uint32_t ICPR[8];
+	uint32_t reserved3[24];
+	__IO uint32_t IABR[8];
+	uint32_t reserved4[56];
+	__IO uint8_t IP[240];
+} NVIC_Type;
+
+typedef struct {
+	__IO uint32_t CTRL, CYCCNT;
+} DWT_Type;
+
+typedef struct {
+	__IO uint32_t DHCSR, DCRSR, DCRDR, DEMCR;
+} CoreDebug_Type;
+
+// the peripherals, indexed by their number
+extern TIM_TypeDef mock_tim[5];
+extern DMA_Channel_TypeDef mock_dma_ch[8];
+extern DMA_TypeDef mock_dma1;
+extern USART_TypeDef mock_usart1;
+extern RCC_TypeDef mock_rcc;
+extern GPIO_TypeDef mock_gpio[3];
+extern AFIO_TypeDef mock_afio;
+extern CRC_TypeDef mock_crc;
+extern DBGMCU_TypeDef mock_dbgmcu;
+extern NVIC_Type mock_nvic;
+extern DWT_Type mock_dwt;
+extern CoreDebug_Type mock_core_debug;
+
+#define TIM2			(&mock_tim[2])
+#define TIM3			(&mock_tim[3])
+#define TIM4			(&mock_tim[4])
+#define DMA1			(&mock_dma1)
+#define DMA1_Channel1	(&mock_dma_ch[1])
+#define DMA1_Channel2	(&mock_dma_ch[2])
+#define DMA1_Channel3	(&mock_dma_ch[3])
+#define DMA1_Channel4	(&mock_dma_ch[4])
+#define DMA1_Channel5	(&mock_dma_ch[5])
+#define DMA1_Channel6	(&mock_dma_ch[6])
+#define DMA1_Channel7	(&mock_dma_ch[7])
+#define USART1			(&mock_usart1)
+#define RCC				(&mock_rcc)
+#define GPIOA			(&mock_gpio[0])
+#define GPIOB			(&mock_gpio[1])
+#define GPIOC			(&mock_gpio[2])
+#define AFIO			(&mock_afio)
+#define CRC				(&mock_crc)
+#define DBGMCU			(&mock_dbgmcu)
+#define NVIC			(&mock_nvic)
+#define DWT				(&mock_dwt)
+#define CoreDebug		(&mock_core_debug)
+
+extern uint32_t SystemCoreClock;
+
+#define CRC_CR_RESET				0x00000001
+
+#define DBGMCU_CR_DBG_SLEEP			0x00000001
+
+#define CoreDebug_DEMCR_TRCENA_Msk	0x01000000
+#define DWT_CTRL_CYCCNTENA_Msk		0x00000001
+
+#define DMA_CCR1_EN			0x0001
+#define DMA_CCR1_TCIE		0x0002
+#define DMA_CCR1_HTIE		0x0004
+#define DMA_CCR1_TEIE		0x0008
+#define DMA_CCR1_DIR		0x0010
+#define DMA_CCR1_CIRC		0x0020
+#define DMA_CCR1_PINC		0x0040
+#define DMA_CCR1_MINC		0x0080
+#define DMA_CCR1_PSIZE_0	0x0100
+#define DMA_CCR1_PSIZE_1	0x0200
+#define DMA_CCR1_MSIZE_0	0x0400
+#define DMA_CCR1_MSIZE_1	0x0800
+#define DMA_CCR1_PL_0		0x1000
+#define DMA_CCR1_PL_1		0x2000
+
+// channel n's flags are 4 bits, global, transfer complete, half transfer and error, from bit 4 * (n - 1)
+#define DMA_ISR_GIF2		0x00000010
+#define DMA_ISR_TCIF2		0x00000020
+#define DMA_ISR_HTIF2		0x00000040
+#define DMA_ISR_TCIF4		0x00002000
+#define DMA_ISR_TCIF5		0x00020000
+#define DMA_ISR_HTIF5		0x00040000
+#define DMA_IFCR_CGIF2		0x00000010
+#define DMA_IFCR_CTCIF2		0x00000020
+#define DMA_IFCR_CHTIF2		0x00000040
+#define DMA_IFCR_CGIF4		0x00001000
+#define DMA_IFCR_CGIF5		0x00010000
+
+#define RCC_AHBENR_DMA1EN	0x00000001
+#define RCC_AHBENR_CRCEN	0x00000040
+#define RCC_APB1ENR_TIM2EN	0x00000001
+#define RCC_APB1ENR_TIM3EN	0x00000002
+#define RCC_APB1ENR_TIM4EN	0x00000004
+
+#define TIM_CR1_CEN			0x0001
+#define TIM_CR1_UDIS		0x0002
+#define TIM_CR1_URS			0x0004
+#define TIM_CR1_OPM			0x0008
+#define TIM_CR1_ARPE		0x0080
+#define TIM_DIER_UIE		0x0001
+#define TIM_DIER_CC1IE		0x0002
+#define TIM_DIER_CC2IE		0x0004
+#define TIM_DIER_UDE		0x0100
+#define TIM_DIER_CC1DE		0x0200
+#define TIM_SR_UIF			0x0001
+#define TIM_SR_CC1IF		0x0002
+#define TIM_EGR_UG			0x0001
+#define TIM_CCMR1_OC1PE		0x0008
+
+#define USART_SR_ORE		0x0008
+#define USART_SR_IDLE		0x0010
+#define USART_SR_RXNE		0x0020
+#define USART_SR_TC			0x0040
+#define USART_SR_TXE		0x0080
+#define USART_CR1_IDLEIE	0x0010
+#define USART_CR1_RXNEIE	0x0020
+#define USART_CR3_DMAR		0x0040
+#define USART_CR3_DMAT		0x0080
+
+// called at every barrier when set, so a test can interleave another thread or interrupt there
+extern void (*mock_barrier_hook)(void);
+// called for WFI when set, so a test can decide how long the CPU sleeps
+extern void (*mock_wfi_hook)(void);
+
+// core intrinsics, the barrier is a real one so snapshots can be tested across host threads
+static inline void __DMB(void)
+{
+	__sync_synchronize();
+	if (mock_barrier_hook) {
+		mock_barrier_hook();
+	}
+}
+static inline void __NOP(void) {}
+static inline void __WFI(void)
+{
+	if (mock_wfi_hook) {
+		mock_wfi_hook();
+	}
+}
+static inline void __CLREX(void) {}
+// the tests call interrupt handlers themselves, so masking has nothing to do
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline void __set_BASEPRI(uint32_t basePri) { (void)basePri; }
+static inline uint32_t __get_BASEPRI(void) { return 0; }
+// exclusive access on one host thread at a time always succeeds
+static inline uint32_t __LDREXW(volatile uint32_t *addr) { return *addr; }
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t *addr) { *addr = value; return 0; }
+
+// the parts of the standard peripheral library that are used
+typedef enum {
+	GPIO_Speed_10MHz = 1,
+	GPIO_Speed_2MHz,
+	GPIO_Speed_50MHz,
+} GPIOSpeed_TypeDef;
+
+typedef enum {
+	GPIO_Mode_Out_PP = 0x10,
+} GPIOMode_TypeDef;
+
+typedef struct {
+	uint16_t GPIO_Pin;
+	GPIOSpeed_TypeDef GPIO_Speed;
+	GPIOMode_TypeDef GPIO_Mode;
+} GPIO_InitTypeDef;
+
+#define GPIO_Pin_All		0xFFFF
+
+void GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init);
+void GPIO_Write(GPIO_TypeDef *port, uint16_t value);
@@ -0,0 +1,41 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Checks for the host tests. A failed check is printed and counted,
+ * and the test keeps going so one run shows every failure.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+/** Counts a failure if cond is false. */
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		++test_failures; \
+	} \
+} while (0)
+
+/** Counts a failure if a and b differ, printing both. */
+#define CHECK_EQ(a, b) do { \
+	long long const test_a = (long long)(a); \
+	long long const test_b = (long long)(b); \
+	if (test_a != test_b) { \
+		fprintf(stderr, "%s:%d: check failed: %s == %s (%lld != %lld)\n", \
+			__FILE__, __LINE__, #a, #b, test_a, test_b); \
+		++test_failures; \
+	} \
+} while (0)
+
+/** Prints the result, returns the exit code for main. */
+static inline int test_result(char const *name)
+{
+	printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+	return test_failures != 0;
+}
@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+#
+# CE 426 - Real-Time Embedded Systems
+# Instructor: Dr. Tewolde
+# Author: Benjamin Hall
+# Final Project: Function Generator
+#
+# Loopback test of the binary command link over a pseudo-terminal.
+# link_host runs the firmware's UART and waveform threads on the simulated peripherals,
+# and tools/funcgen_link.py drives it the way a test rack script would, with the menus
+# still running around the link.
+
+import os
+import random
+import struct
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, '..', 'tools'))
+import funcgen_link as fl
+import trace_decode
+
+SINE = fl.WAVEFORMS.index('sine')
+SAWTOOTH = fl.WAVEFORMS.index('sawtooth')
+TRIANGLE = fl.WAVEFORMS.index('triangle')
+PWM = fl.WAVEFORMS.index('pwm')
+
+failures = 0
+
+
+def check(cond, what):
+	global failures
+	if not cond:
+		print('check failed: %s' % what, file=sys.stderr)
+		failures += 1
+
+
+def expect_error(name, fn, *args, **kwargs):
+	"""Checks that a command fails with the named status."""
+	try:
+		fn(*args, **kwargs)
+		check(False, 'expected %s' % name)
+	except fl.LinkError as e:
+		check(name in str(e), '%s, got %s' % (name, e))
+
+
+def mpeg2(data):
+	"""CRC-32/MPEG-2, bytes most significant bit first."""
+	crc = 0xFFFFFFFF
+	for byte in data:
+		crc ^= byte << 24
+		for _ in range(8):
+			crc = ((crc << 1) ^ 0x04C11DB7 if crc & 0x80000000 else crc << 1) & 0xFFFFFFFF
+	return crc
+
+
+def test_encoding():
+	# the CRC unit's CRC is CRC-32/MPEG-2 over each little-endian word's bytes, most significant first
+	check(mpeg2(b'123456789') == 0x0376E6E7, 'mpeg2 check value')
+	data = bytes(range(1, 13))
+	check(fl.crc32(data) == mpeg2(b''.join(data[i:i + 4][::-1] for i in range(0, 12, 4))), 'crc32 word order')
+	rand = random.Random(426)
+	for n in range(600):
+		data = bytes(rand.choice([0, 0, 1, 0xFF, rand.randrange(256)]) for _ in range(n))
+		encoded = fl.cobs_encode(data)
+		check(0 not in encoded and fl.cobs_decode(encoded) == data, 'cobs round trip of %d bytes' % n)
+
+
+def raw_frame(seq, op, payload):
+	"""A command frame as funcgen_link.py sends it, with a given sequence number."""
+	body = bytes([seq, op]) + payload
+	return b'\0' + fl.cobs_encode(body + struct.pack('<I', fl.crc32(body))) + b'\0'
+
+
+def read_text(link, want, timeout=1.0):
+	"""Reads menu text until want shows up, returns all of it."""
+	text = bytes(link.rx)
+	link.rx.clear()
+	deadline = time.monotonic() + timeout
+	while want not in text and time.monotonic() < deadline:
+		time.sleep(0.01)
+		try:
+			text += os.read(link.fd, 4096)
+		except BlockingIOError:
+			pass
+	return text
+
+
+def test_link(link):
+	check(link.ping() == (1, 72000000), 'ping')
+
+	# params are applied together by the waveform thread, and read back from its status
+	link.set(SINE, amplitude=50, freq=1234567, rate=10000)
+	status = link.get(SINE)
+	check((status['freq'], status['rate'], status['amplitude'], status['enabled']) == (1234567, 10000, 50, False),
+		'sine status %s' % status)
+
+	# a bad param leaves everything as it was
+	expect_error('bad argument', link.set, SAWTOOTH, rate=1234)
+	expect_error('bad argument', link.set, SINE, duty=5)
+	expect_error('bad argument', link.set, 7, amplitude=1)
+	expect_error('bad argument', link.set, SINE, amplitude=20, freq=50000001)
+	check(link.get(SINE)['amplitude'] == 50, 'sine untouched by a bad set')
+	expect_error('unknown opcode', link.command, 0x55)
+	expect_error('bad length', link.command, fl.OP_GET, b'')
+
+	# enabling is absolute, and only one waveform is enabled at a time
+	link.enable(SINE, True)
+	link.enable(SINE, True)
+	check(link.get(SINE)['enabled'], 'sine enabled')
+	link.enable(TRIANGLE, True)
+	check(link.get(TRIANGLE)['enabled'] and not link.get(SINE)['enabled'], 'triangle took over from sine')
+	link.enable(TRIANGLE, False)
+	link.enable(TRIANGLE, False)
+	# a frequency that loops from a table, and the PWM timer, so every output path has run
+	link.set(SAWTOOTH, freq=1000000, rate=100000)
+	link.enable(SAWTOOTH, True)
+	link.enable(PWM, True)
+	check(link.get(PWM)['enabled'] and not link.get(SAWTOOTH)['enabled'], 'pwm took over from sawtooth')
+	link.enable(PWM, False)
+	check(not any(link.get(wave)['enabled'] for wave in (PWM, SAWTOOTH, SINE, TRIANGLE)), 'all disabled')
+
+	# a command near the largest frame, with zeros all through it
+	payload = bytes([TRIANGLE]) + b''.join(struct.pack('<BI', 0, 0) for _ in range(49))
+	link.command(fl.OP_SET, payload)
+	check(link.get(TRIANGLE)['amplitude'] == 0, 'long command applied')
+
+	# a retry with the same sequence number gets the same reply and isn't run again
+	applied = link.stats()['cfg applied'][0]
+	link.seq = (link.seq + 1) & 0xFF
+	frame = raw_frame(link.seq, fl.OP_ENABLE, bytes([SAWTOOTH, 1]))
+	os.write(link.fd, frame)
+	first = link._read_frame(time.monotonic() + 1)
+	os.write(link.fd, frame)
+	second = link._read_frame(time.monotonic() + 1)
+	check(first is not None and first == second and first[2] == 0, 'retry got the same reply')
+	check(link.stats()['cfg applied'][0] == applied + 1, 'retry not run again')
+	check(link.get(SAWTOOTH)['enabled'], 'sawtooth enabled once')
+	link.enable(SAWTOOTH, False)
+
+	# corrupted and oversized frames get no reply, and are counted
+	bad = link.stats()['link bad frames'][0]
+	corrupt = bytearray(raw_frame((link.seq + 1) & 0xFF, fl.OP_PING, b''))
+	corrupt[3] ^= 0x10
+	os.write(link.fd, bytes(corrupt))
+	check(link._read_frame(time.monotonic() + 0.3) is None, 'no reply to a corrupted frame')
+	os.write(link.fd, b'\0' + b'\x07' * 400 + b'\0')
+	check(link._read_frame(time.monotonic() + 0.3) is None, 'no reply to an oversized frame')
+	check(link.stats()['link bad frames'][0] == bad + 2, 'bad frames counted')
+
+	# the trace is read over several replies, then starts over
+	records = link.trace()
+	check(len(records) > fl.MAX_FRAME // 8, 'trace spans several replies, %d records' % len(records))
+	# the time is a free running 32 bit count
+	check(all((b[0] - a[0]) & 0xFFFFFFFF < 1 << 31 for a, b in zip(records, records[1:])), 'trace in time order')
+	check(len(link.trace()) < len(records), 'trace started over')
+
+	# a read given up after the first reply doesn't leave recording paused
+	for i in range(10):
+		link.set(SINE, amplitude=50)
+	count = struct.unpack_from('<H', link.command(fl.OP_TRACE, struct.pack('<H', 0)))[0]
+	check(count > fl.MAX_FRAME // 8, 'more than one reply of records, %d' % count)
+	link.set(SINE, amplitude=50)
+	events = [trace_decode.EVENTS[r[1]] for r in link.trace() if r[1] < len(trace_decode.EVENTS)]
+	check(len(events) < count and 'cfg get' in events, 'recording again after an abandoned read: %s' % events)
+
+
+def test_menus(link):
+	# closing goes back to the menus, which share the config with the link
+	link.trace()
+	link.command(fl.OP_CLOSE)
+	os.write(link.fd, b'y')
+	check(b'Invalid input' in read_text(link, b'Invalid input'), 'menus back after close')
+	os.write(link.fd, b'6')
+	read_text(link, b'Selection: ')
+	renders = 10
+	for i in range(renders):
+		os.write(link.fd, b'4')
+		text = read_text(link, b'Selection: ')
+		check(b'Amplitude: 50%' in text and b'Frequency: 1234.567 Hz' in text, 'sine menu shows what was set over the link')
+		os.write(link.fd, b'\x1b')
+		read_text(link, b'Selection: ')
+
+	# the menus read the published status, the only config mail is Esc disabling the waveform on the way out
+	os.write(link.fd, b'5')
+	report = read_text(link, b'Selection: ')
+	line = next((l for l in report.decode().splitlines() if l.startswith('menu render: ')), '')
+	check(line.startswith('menu render: %d, ' % renders), 'menu renders profiled: %s' % line)
+	print('%s ns min / mean / max on this host, no config mail' % line)
+
+	# any prompt opens the link again
+	check(link.ping()[1] == 72000000, 'link reopened')
+	events = [trace_decode.EVENTS[r[1]] for r in link.trace() if r[1] < len(trace_decode.EVENTS)]
+	check(events.count('cfg send') == renders and events.count('cfg get') == renders,
+		'config mail only from Esc: %s' % events)
+
+	# a point with no digits isn't a frequency of 0, the menu asks again
+	link.command(fl.OP_CLOSE)
+	os.write(link.fd, b'4')
+	read_text(link, b'Selection: ')
+	os.write(link.fd, b'2')
+	read_text(link, b'Hz]: ')
+	os.write(link.fd, b'.\r')
+	text = read_text(link, b'Hz]: ')
+	check(b'Invalid input' in text and text.endswith(b'Hz]: '), 'lone point refused: %r' % text[-60:])
+	os.write(link.fd, b'1234.567\r')
+	read_text(link, b'Selection: ')
+	os.write(link.fd, b'\x1b')
+	read_text(link, b'Selection: ')
+	check(link.get(SINE)['freq'] == 1234567, 'sine frequency kept')
+
+
+def test_rate(link):
+	# round trips over the pseudo-terminal, this measures the host and its pty, not the 115200 baud line
+	count = 1000
+	start = time.monotonic()
+	for i in range(count):
+		link.set(SINE, amplitude=i % 101)
+		check(link.get(SINE)['amplitude'] == i % 101, 'amplitude %d' % (i % 101))
+	elapsed = time.monotonic() - start
+	print('%d set and get round trips over the host pty in %.2f s, %.0f commands/s'
+		% (count, elapsed, 2 * count / elapsed))
+
+
+def main():
+	test_encoding()
+
+	master, slave = os.openpty()
+	host = subprocess.Popen([os.path.join(HERE, 'link_host'), str(master)], pass_fds=[master],
+		stderr=subprocess.PIPE)
+	os.close(master)
+	link = fl.Link(os.ttyname(slave), timeout=0.5)
+	os.close(slave)
+	try:
+		# the main menu is already out, the first command opens the link through it
+		test_link(link)
+		test_menus(link)
+		test_rate(link)
+		link.close()
+		# the harness exits once the pseudo-terminal is closed, with how deep the waveform thread's stack went
+		report = host.communicate(timeout=5)[1].decode()
+		print(report, end='')
+		check('bytes used below waveform_thread' in report, 'waveform thread stack reported')
+	finally:
+		if host.poll() is None:
+			host.kill()
+			host.wait()
+
+	print('cmd_link: %s' % ('FAILED' if failures else 'ok'))
+	return failures != 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
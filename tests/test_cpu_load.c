@@ -0,0 +1,84 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Tests the CPU load meter on the host clock.
+ * The idle demon is stood in for by calling cpu_load_idle, with WFI sleeping for a set
+ * time, and the busy time by spinning on the clock. The clock counts ns, so the core
+ * clock is set to 1 GHz to keep the windows at 100 ms and 1 s.
+ * Under full load the idle demon never runs, and the load has to read 100% once a
+ * window has gone by instead of holding the figure from before.
+ */
+
+#include "cpu_load.h"
+#include "profile.h"
+#include "stm32f10x.h"
+#include "test.h"
+#include <time.h>
+
+#define MS	1000000
+
+/** Busy for ns on the host clock. */
+static void spin(uint32_t ns)
+{
+	uint32_t const start = profile_now();
+	while (profile_now() - start < ns) {
+	}
+}
+
+// how long WFI sleeps before a wakeup comes
+static long sleepNs = MS / 2;
+
+static void wfi_sleep(void)
+{
+	struct timespec const ts = { 0, sleepNs };
+	nanosleep(&ts, NULL);
+}
+
+int main(void)
+{
+	SystemCoreClock = 1000000000;
+	mock_wfi_hook = wfi_sleep;
+	cpu_load_init();
+
+	// half busy, half asleep, the sleep overshoots on the host so the load reads a little under half
+	uint32_t const start = profile_now();
+	while (profile_now() - start < 300 * MS) {
+		cpu_load_idle();
+		spin(MS / 2);
+	}
+	uint16_t const half = cpu_load_permille(CPU_LOAD_100MS);
+	uint32_t const wakeups = cpu_load_wakeups(CPU_LOAD_100MS);
+	CHECK(half >= 300 && half <= 700);
+	CHECK(wakeups >= 50 && wakeups <= 100);
+	printf("half load: %u.%u%% over 100 ms, %u wakeups\n", half / 10, half % 10, wakeups);
+
+	// full load, the idle demon doesn't run to close the window
+	// the first window read out started under half load, so it's only partly busy
+	spin(150 * MS);
+	uint16_t const rising = cpu_load_permille(CPU_LOAD_100MS);
+	CHECK(rising >= half + 100);
+	spin(100 * MS);
+	uint16_t const full = cpu_load_permille(CPU_LOAD_100MS);
+	CHECK_EQ(full, 1000);
+	CHECK_EQ(cpu_load_wakeups(CPU_LOAD_100MS), 0);
+	printf("full load: %u.%u%% over 100 ms after 150 ms of it, %u.%u%% after 250 ms\n",
+		rising / 10, rising % 10, full / 10, full % 10);
+
+	// one long sleep, the window it ends is all idle
+	sleepNs = 120 * MS;
+	cpu_load_idle();
+	uint16_t const idle = cpu_load_permille(CPU_LOAD_100MS);
+	CHECK(idle <= 50);
+	CHECK_EQ(cpu_load_wakeups(CPU_LOAD_100MS), 0);
+	printf("back to idle: %u.%u%% over 100 ms\n", idle / 10, idle % 10);
+
+	// full load again straight after, the window the sleep closed is all that was read before
+	spin(150 * MS);
+	uint16_t const again = cpu_load_permille(CPU_LOAD_100MS);
+	CHECK_EQ(again, 1000);
+	printf("full load after idle: %u.%u%% over 100 ms after 150 ms of it\n", again / 10, again % 10);
+	return test_result("cpu_load");
+}
@@ -0,0 +1,149 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Measures the frequency of the streamed sine, sawtooth and triangle at the port.
+ * Each shape is streamed through the simulated TIM2 and DMA1 channel 2, and the rising
+ * crossings of the midpoint are counted over a run of samples. The phase just past the
+ * first and last crossing is read back from the sample value, so the phase covered
+ * between them is known to a fraction of a sample. The measured frequency has to be
+ * within fs / 2^32 of the requested one, the step of the 32-bit phase accumulator.
+ */
+
+#include "mock.h"
+#include "sawtooth_wave.h"
+#include "sine_wave.h"
+#include "test.h"
+#include "triangle_wave.h"
+#include "wave_out.h"
+#include <math.h>
+
+// samples followed for each frequency, the phase read back is good to well under half this
+#define NUM_SAMPLES	(1 << 17)
+#define MIDPOINT	0x8000
+
+/** Phase past the rising midpoint crossing of a sample value, for a shape at 100% amplitude. */
+typedef int64_t (*phase_fn_t)(uint16_t value);
+
+static int64_t sawtooth_phase(uint16_t value)
+{
+	// the ramp is the top 16 bits of the phase, take the middle of the step
+	return ((int64_t)value << 16) + (1 << 15) - (1LL << 31);
+}
+
+static int64_t triangle_phase(uint16_t value)
+{
+	// rising half, the value is the phase over 2^15, crossing the midpoint at the quarter period
+	return ((int64_t)value << 15) + (1 << 14) - (1LL << 30);
+}
+
+static int64_t sine_phase(uint16_t value)
+{
+	return llround(asin((value - MIDPOINT) / 32767.5) / (2 * M_PI) * 4294967296.0);
+}
+
+typedef struct {
+	char const *name;
+	waveform_ops_t const *ops;
+	phase_fn_t phase;
+} shape_t;
+
+static shape_t const shapes[] = {
+	{ "sine", &sine_wave_ops, sine_phase },
+	{ "sawtooth", &sawtooth_wave_ops, sawtooth_phase },
+	{ "triangle", &triangle_wave_ops, triangle_phase },
+};
+
+/** Frequencies that can't loop from the buffer, all under a quarter of the rate so a crossing can be read back. */
+static struct {
+	uint32_t freqMhz;
+	uint32_t rateHz;
+} const cases[] = {
+	{ 100, WAVE_OUT_MIN_RATE_HZ },
+	{ 7777, 100000 },
+	{ 1234567, 10000 },
+	{ 999999, 48000 },
+	{ 1234567, 48000 },
+	{ 12345678, 100000 },
+	{ 98765432, WAVE_OUT_MAX_RATE_HZ },
+};
+
+/** Sends a shape a batch of params. */
+static void apply(shape_t const *shape, uint32_t freqMhz, uint32_t rateHz, uint8_t bEnable)
+{
+	waveform_batch_t batch = {0};
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_SAMPLE_RATE, rateHz });
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_FREQ_MHZ, freqMhz });
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_ENABLE, bEnable });
+	shape->ops->set(&batch);
+}
+
+/** Streams a shape and checks the frequency at the port. Returns the error in Hz. */
+static double measure(shape_t const *shape, uint32_t freqMhz, uint32_t rateHz)
+{
+	mock_reset();
+	wave_out_init();
+	apply(shape, freqMhz, rateHz, 1);
+
+	wave_out_status_t status;
+	wave_out_get_status(&status);
+	CHECK_EQ(status.mode, WAVE_OUT_STREAM);
+
+	// the first and last crossing, the timer clock and phase of the sample just past each
+	uint32_t crossings = 0;
+	uint64_t firstClock = 0;
+	uint64_t lastClock = 0;
+	int64_t firstPhase = 0;
+	int64_t lastPhase = 0;
+
+	mock_tim_step(2);
+	uint16_t prev = GPIOB->ODR;
+	for (uint32_t i = 1; i < NUM_SAMPLES; ++i) {
+		mock_tim_until_update(2);
+		mock_irq_run();
+		uint16_t const value = GPIOB->ODR;
+		if (prev < MIDPOINT && value >= MIDPOINT) {
+			if (crossings++ == 0) {
+				firstClock = mock_clock;
+				firstPhase = shape->phase(value);
+			}
+			lastClock = mock_clock;
+			lastPhase = shape->phase(value);
+		}
+		prev = value;
+	}
+	apply(shape, freqMhz, rateHz, 0);
+
+	CHECK(crossings >= 2);
+	if (crossings < 2) {
+		return INFINITY;
+	}
+
+	// the phase covered over the time between them, in periods of 2^32
+	__int128 const phase = ((__int128)(crossings - 1) << 32) + lastPhase - firstPhase;
+	__int128 const clocks = lastClock - firstClock;
+	// |phase * TIM_CLK / (clocks * 2^32) - f| <= fs / 2^32, scaled up to whole numbers in mHz
+	__int128 const errorScaled = phase * TIM_CLK_HZ * 1000 - ((__int128)freqMhz * clocks << 32);
+	__int128 const limit = (__int128)rateHz * 1000 * clocks;
+	CHECK((errorScaled < 0 ? -errorScaled : errorScaled) <= limit);
+	return (double)errorScaled / ((double)clocks * 4294967296.0 * 1000);
+}
+
+int main(void)
+{
+	for (uint32_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+		shapes[s].ops->init();
+	}
+
+	for (uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+		printf("%10u mHz at %6u SPS, fs / 2^32 %.3g Hz, error:", cases[c].freqMhz, cases[c].rateHz,
+			cases[c].rateHz / 4294967296.0);
+		for (uint32_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+			printf(" %s %+.3g Hz", shapes[s].name, measure(&shapes[s], cases[c].freqMhz, cases[c].rateHz));
+		}
+		printf("\n");
+	}
+	return test_result("freq");
+}
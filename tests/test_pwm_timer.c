@@ -0,0 +1,197 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Tests the PWM timer backend: the TIM3 register values for a period and duty cycle,
+ * and the edges the simulated TIM3 and DMA1 channels 3 and 6 put on the waveform port.
+ */
+
+#include "mock.h"
+#include "pwm_timer.h"
+#include "test.h"
+
+// q0.10 duty cycles
+#define DUTY_0		0
+#define DUTY_25		256
+#define DUTY_50		512
+#define DUTY_100	1024
+
+#define AMPLITUDE	0x0ABC
+
+/** An edge seen on the waveform port. */
+typedef struct {
+	/** Timer clocks since the PWM started */
+	uint64_t time;
+	/** Level after the edge */
+	uint16_t level;
+} edge_t;
+
+/** Runs TIM3 for ticks timer clocks, recording up to max edges. Returns the number recorded. */
+static uint32_t run_edges(uint64_t ticks, edge_t *edges, uint32_t max)
+{
+	uint32_t count = 0;
+	uint16_t level = GPIOB->ODR;
+	uint64_t const end = mock_clock + ticks;
+	while (mock_clock < end) {
+		uint64_t const before = mock_clock;
+		mock_tim_step(3);
+		if (GPIOB->ODR != level && count < max) {
+			level = GPIOB->ODR;
+			edges[count].time = mock_clock;
+			edges[count].level = level;
+			++count;
+		}
+		if (mock_clock == before) {
+			// stopped
+			break;
+		}
+	}
+	return count;
+}
+
+/** Starts the PWM from reset. */
+static void start(pwm_timer_cfg_t *cfg, uint32_t freqMhz, uint16_t duty)
+{
+	mock_reset();
+	pwm_timer_init();
+	pwm_timer_calc(cfg, freqMhz, duty);
+	pwm_timer_start(cfg, AMPLITUDE);
+}
+
+static void test_calc(void)
+{
+	static uint32_t const freqs[] = { 1, 1000, 10000, 999999, 1000000, 1234567, 50000000, 1000000000 };
+	for (uint32_t i = 0; i < sizeof(freqs) / sizeof(freqs[0]); ++i) {
+		pwm_timer_cfg_t cfg;
+		pwm_timer_calc(&cfg, freqs[i], DUTY_50);
+		uint64_t const want = (TIM_CLK_HZ * 1000ull + freqs[i] / 2) / freqs[i];
+		uint64_t const got = (uint64_t)(cfg.reload + 1) * (cfg.prescaler + 1);
+		uint64_t const counts = cfg.reload + 1;
+		if (want <= 0xFFFFull * 0x10000) {
+			// within half a count of the period
+			CHECK(got + (cfg.prescaler + 1) / 2 >= want && got <= want + (cfg.prescaler + 1) / 2);
+		} else {
+			// clamped to the longest period
+			CHECK(got >= 0xFFFFull * 0xFFFF);
+		}
+		CHECK_EQ(cfg.compare, (counts * DUTY_50) >> 10);
+	}
+
+	// periods that divide the timer clock are exact
+	pwm_timer_cfg_t cfg;
+	pwm_timer_calc(&cfg, 1000000, DUTY_25);
+	CHECK_EQ((uint64_t)(cfg.reload + 1) * (cfg.prescaler + 1), 72000);
+	CHECK_EQ(cfg.compare * 4, cfg.reload + 1);
+	pwm_timer_calc(&cfg, 1000, DUTY_25);
+	CHECK_EQ((uint64_t)(cfg.reload + 1) * (cfg.prescaler + 1), 72000000);
+
+	// the extremes have no low edge, or no high one
+	pwm_timer_calc(&cfg, 1000000, DUTY_100);
+	CHECK(cfg.compare > cfg.reload);
+	pwm_timer_calc(&cfg, 1000000, DUTY_0);
+	CHECK_EQ(cfg.compare, 0);
+}
+
+/** Checks the port has the period and on time, in timer clocks, for a few periods. */
+static void check_edges(uint64_t period, uint64_t onTime)
+{
+	edge_t edges[16];
+	uint32_t const count = run_edges(6 * period, edges, 16);
+	CHECK(count >= 8);
+	for (uint32_t i = 0; i + 2 < count; i += 2) {
+		CHECK_EQ(edges[i].level, 0);
+		CHECK_EQ(edges[i + 1].level, AMPLITUDE);
+		CHECK_EQ(edges[i + 2].time - edges[i].time, period);
+		CHECK_EQ(edges[i + 1].time - edges[i].time, period - onTime);
+	}
+}
+
+static void test_edges(void)
+{
+	pwm_timer_cfg_t cfg;
+	// 1 kHz at 25%
+	start(&cfg, 1000000, DUTY_25);
+	CHECK(pwm_timer_running());
+	// the update that loads the timing writes the first high level
+	mock_tim_step(3);
+	CHECK_EQ(GPIOB->ODR, AMPLITUDE);
+	check_edges(72000, 18000);
+
+	// 12.5 Hz at 50% needs the prescaler
+	start(&cfg, 12500, DUTY_50);
+	CHECK(cfg.prescaler > 0);
+	mock_tim_step(3);
+	check_edges(5760000, 2880000);
+
+	// 100% never goes low
+	start(&cfg, 1000000, DUTY_100);
+	mock_tim_step(3);
+	edge_t edges[4];
+	CHECK_EQ(run_edges(10 * 72000, edges, 4), 0);
+	CHECK_EQ(GPIOB->ODR, AMPLITUDE);
+
+	// 0% holds the port low without running the timer, there are no pulses at all
+	mock_reset();
+	pwm_timer_init();
+	GPIOB->ODR = 0xFFFF;
+	pwm_timer_calc(&cfg, 1000000, DUTY_0);
+	pwm_timer_start(&cfg, AMPLITUDE);
+	CHECK(!pwm_timer_running());
+	CHECK_EQ(GPIOB->ODR, 0);
+	CHECK_EQ(run_edges(10 * 72000, edges, 4), 0);
+	CHECK_EQ(mock_dma_moved(3), 0);
+}
+
+static void test_update(void)
+{
+	pwm_timer_cfg_t cfg;
+	start(&cfg, 1000000, DUTY_25);
+	mock_tim_step(3);
+	edge_t edges[16];
+	// a little way into the first period
+	run_edges(1000, edges, 16);
+
+	// a new duty cycle and frequency land together at the start of the next period
+	pwm_timer_cfg_t next;
+	pwm_timer_calc(&next, 500000, DUTY_50);
+	pwm_timer_update(&next, AMPLITUDE);
+	uint32_t const count = run_edges(71000 + 3 * 144000, edges, 16);
+	CHECK(count >= 6);
+	// the low edge of the period in progress is still at 25% of 1 ms
+	CHECK_EQ(edges[0].level, 0);
+	CHECK_EQ(edges[0].time, 18000);
+	CHECK_EQ(edges[1].level, AMPLITUDE);
+	CHECK_EQ(edges[1].time, 72000);
+	// then 500 Hz at 50%
+	CHECK_EQ(edges[2].time - edges[1].time, 72000);
+	CHECK_EQ(edges[3].time - edges[1].time, 144000);
+
+	// down to 0% stops and holds the port low, back up starts a new period
+	pwm_timer_calc(&next, 500000, DUTY_0);
+	pwm_timer_update(&next, AMPLITUDE);
+	CHECK(!pwm_timer_running());
+	CHECK_EQ(GPIOB->ODR, 0);
+	pwm_timer_calc(&next, 500000, DUTY_50);
+	pwm_timer_update(&next, AMPLITUDE);
+	CHECK(pwm_timer_running());
+	mock_tim_step(3);
+	CHECK_EQ(GPIOB->ODR, AMPLITUDE);
+	check_edges(144000, 72000);
+
+	// stopped, the port keeps its last level
+	pwm_timer_stop();
+	CHECK(!pwm_timer_running());
+	uint16_t const level = GPIOB->ODR;
+	CHECK_EQ(run_edges(144000, edges, 16), 0);
+	CHECK_EQ(GPIOB->ODR, level);
+}
+
+int main(void)
+{
+	test_calc();
+	test_edges();
+	test_update();
+	return test_result("pwm_timer");
+}
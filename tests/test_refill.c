@@ -0,0 +1,158 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Simulates the stream refill deadline at the max sample rate.
+ * A sine is streamed through the simulated TIM2 and DMA1 channel 2, and the refill
+ * interrupt is held off for longer and longer after it's requested, as if other work
+ * was in the way. The port has to see exactly the same samples as when the refill runs
+ * straight away for every hold off up to half a buffer of samples, which is the deadline.
+ * Then each refill is held off a different amount, as typing would, and the timing of
+ * the refills and of the samples reaching the port is measured in timer clocks.
+ */
+
+#include "mock.h"
+#include "profile.h"
+#include "sine_wave.h"
+#include "test.h"
+#include "wave_out.h"
+
+// samples followed for each hold off
+#define NUM_SAMPLES	(24 * WAVE_OUT_STREAM_HALF_LEN)
+// a frequency that can't loop from the buffer at the max rate, so it streams
+#define FREQ_MHZ	1234567
+
+static uint16_t reference[NUM_SAMPLES];
+static uint16_t output[NUM_SAMPLES];
+
+// timer clocks at each sample reaching the port, and at each refill
+static uint64_t sampleClock[NUM_SAMPLES];
+static uint64_t refillClock[NUM_SAMPLES / WAVE_OUT_STREAM_HALF_LEN + 1];
+static uint32_t numRefills;
+static uint32_t seed;
+
+/** The hold off for the next refill, anywhere from none up to max. */
+static uint32_t vary(uint32_t max)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) % (max + 1);
+}
+
+/** Returns the most an interval between successive clocks differs from period. */
+static uint64_t jitter(uint64_t const *clocks, uint32_t count, uint64_t period)
+{
+	uint64_t most = 0;
+	for (uint32_t i = 1; i < count; ++i) {
+		uint64_t const interval = clocks[i] - clocks[i - 1];
+		uint64_t const off = (interval > period) ? interval - period : period - interval;
+		most = (off > most) ? off : most;
+	}
+	return most;
+}
+
+/** Sends the sine a batch of params. */
+static void sine_apply(uint32_t freqMhz, uint32_t rateHz, uint8_t bEnable)
+{
+	waveform_batch_t batch = {0};
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_SAMPLE_RATE, rateHz });
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_FREQ_MHZ, freqMhz });
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_ENABLE, bEnable });
+	sine_wave_ops.set(&batch);
+}
+
+/**
+ * Streams the sine at the max rate into out, running each refill holdOff samples after it was requested,
+ * or a varying amount up to holdOff if bVary. Returns the fewest samples the engine saw left when a refill finished.
+ */
+static uint16_t stream(uint32_t holdOff, uint8_t bVary, uint16_t *out)
+{
+	mock_reset();
+	wave_out_init();
+	sine_apply(FREQ_MHZ, WAVE_OUT_MAX_RATE_HZ, 1);
+
+	wave_out_status_t status;
+	wave_out_get_status(&status);
+	CHECK_EQ(status.mode, WAVE_OUT_STREAM);
+	CHECK_EQ(status.rateHz, WAVE_OUT_MAX_RATE_HZ);
+
+	// the samples since the refill was requested, -1 when none is waiting
+	int32_t waited = -1;
+	uint32_t hold = holdOff;
+	numRefills = 0;
+	mock_tim_step(2);
+	out[0] = GPIOB->ODR;
+	sampleClock[0] = mock_clock;
+	for (uint32_t i = 1; i < NUM_SAMPLES; ++i) {
+		mock_tim_until_update(2);
+		out[i] = GPIOB->ODR;
+		sampleClock[i] = mock_clock;
+		if (waited < 0 && mock_irq_pending(DMA1_Channel2_IRQn)) {
+			waited = 0;
+			hold = bVary ? vary(holdOff) : holdOff;
+		}
+		if (waited >= 0 && (uint32_t)waited++ == hold) {
+			mock_irq_run();
+			refillClock[numRefills++] = mock_clock;
+			waited = -1;
+		}
+	}
+	wave_out_get_status(&status);
+
+	// disable again, the next run starts from the beginning of a period
+	sine_apply(FREQ_MHZ, WAVE_OUT_MAX_RATE_HZ, 0);
+	return status.refillSlack;
+}
+
+int main(void)
+{
+	sine_wave_ops.init();
+
+	uint16_t const slack = stream(0, 0, reference);
+	CHECK_EQ(slack, WAVE_OUT_STREAM_HALF_LEN);
+	// it's a sine, not a constant
+	uint16_t lo = 0xFFFF;
+	uint16_t hi = 0;
+	for (uint32_t i = 0; i < NUM_SAMPLES; ++i) {
+		lo = (reference[i] < lo) ? reference[i] : lo;
+		hi = (reference[i] > hi) ? reference[i] : hi;
+	}
+	CHECK(hi - lo > 0x8000);
+
+	// every hold off up to the deadline gives the same output, and the engine reports the slack left
+	for (uint32_t holdOff = 1; holdOff <= WAVE_OUT_STREAM_HALF_LEN; ++holdOff) {
+		CHECK_EQ(stream(holdOff, 0, output), WAVE_OUT_STREAM_HALF_LEN - holdOff);
+		if (memcmp(output, reference, sizeof(output)) != 0) {
+			fprintf(stderr, "output differs with the refill held off %u samples\n", holdOff);
+			CHECK(0);
+			break;
+		}
+	}
+
+	// one more and the DMA gets to the half before it's refilled
+	stream(WAVE_OUT_STREAM_HALF_LEN + 1, 0, output);
+	CHECK(memcmp(output, reference, sizeof(output)) != 0);
+
+	// refills held off anywhere up to the deadline still leave every sample on its timer update
+	seed = 426;
+	uint64_t const period = TIM_CLK_HZ / WAVE_OUT_MAX_RATE_HZ;
+	stream(WAVE_OUT_STREAM_HALF_LEN, 1, output);
+	CHECK(memcmp(output, reference, sizeof(output)) == 0);
+	uint64_t const refillJitter = jitter(refillClock, numRefills, WAVE_OUT_STREAM_HALF_LEN * period);
+	uint64_t const sampleJitter = jitter(sampleClock, NUM_SAMPLES, period);
+	CHECK(refillJitter > 0);
+	CHECK_EQ(sampleJitter, 0);
+	printf("refills held off 0 to %u samples: refill jitter %llu cycles, sample jitter %llu cycles at the port\n",
+		WAVE_OUT_STREAM_HALF_LEN, (unsigned long long)refillJitter, (unsigned long long)sampleJitter);
+
+	profile_stats_t refill;
+	profile_read(PROFILE_STREAM_REFILL, &refill);
+	uint32_t const deadlineNs = WAVE_OUT_STREAM_HALF_LEN * (1000000000ull / WAVE_OUT_MAX_RATE_HZ);
+	printf("refill deadline at %u SPS: %u samples, %u ns, %u cycles at %u MHz\n",
+		WAVE_OUT_MAX_RATE_HZ, WAVE_OUT_STREAM_HALF_LEN, deadlineNs,
+		WAVE_OUT_STREAM_HALF_LEN * (TIM_CLK_HZ / WAVE_OUT_MAX_RATE_HZ), TIM_CLK_HZ / 1000000);
+	printf("refill of %u samples on this host: mean %llu ns, max %u ns over %u refills\n",
+		WAVE_OUT_STREAM_HALF_LEN, (unsigned long long)(refill.total / refill.count), refill.max, refill.count);
+	return test_result("refill");
+}
@@ -0,0 +1,248 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Division-free sample path of the sine, sawtooth and triangle.
+ * dds_scale has to match the divide it replaced for every sample and amplitude.
+ * Then the operations each sample costs are counted, for the old 1ms timer callbacks
+ * and for the DDS sample functions, by running both with every operation counted.
+ * The counted DDS samples are checked against what the waveforms put on the port,
+ * so the counts are of the firmware's code and not just of a copy of it.
+ */
+
+#include "dds.h"
+#include "mock.h"
+#include "sawtooth_wave.h"
+#include "sine_wave.h"
+#include "test.h"
+#include "triangle_wave.h"
+#include "utils.h"
+#include "wave_out.h"
+#include <math.h>
+
+// period of the old waveforms, 1 sample per ms
+#define PERIOD_MS		1000
+// table the old sine stepped through
+#define SINE_LOOKUP_SZ	1000
+// quarter table of the DDS sine
+#define QUARTER_BITS	8
+// amplitude the waveforms are checked at, in percent
+#define AMPLITUDE		60
+// the DDS waveforms are rendered as one period of this many samples
+#define RENDER_LEN		100
+
+/** Operations counted per sample. */
+typedef struct {
+	uint32_t div;
+	uint32_t mul;
+	uint32_t alu;
+	uint32_t load;
+	uint32_t branch;
+} ops_t;
+
+static ops_t ops;
+
+// each of these does one operation and counts it
+#define DIV(a, b)	(++ops.div, (a) / (b))
+#define MUL(a, b)	(++ops.mul, (a) * (b))
+#define ALU(x)		(++ops.alu, (x))
+#define LOAD(x)		(++ops.load, (x))
+#define BRANCH(x)	(++ops.branch, (x))
+
+static uint16_t sineLookup[SINE_LOOKUP_SZ];
+static uint16_t quarterTable[(1 << QUARTER_BITS) + 1];
+
+/** Every sample and amplitude scales exactly like sample * amplitude / 0xFFFF. */
+static void test_scale_exact(void)
+{
+	uint64_t mismatches = 0;
+	for (uint32_t amplitude = 0; amplitude <= 0xFFFF; ++amplitude) {
+		uint32_t const scale = dds_amplitude_scale(amplitude);
+		for (uint32_t sample = 0; sample <= 0xFFFF; ++sample) {
+			mismatches += dds_scale(sample, scale) != amplitude * sample / 0xFFFF;
+		}
+	}
+	CHECK_EQ(mismatches, 0);
+}
+
+// old 1ms callbacks, as they were before the waveforms moved to DDS, with each operation counted
+
+static uint16_t old_sine(uint32_t *curTimeMs, uint16_t amplitude)
+{
+	if (BRANCH(LOAD(*curTimeMs) >= PERIOD_MS)) {
+		*curTimeMs = 0;
+	}
+	uint16_t const idx = DIV(MUL(*curTimeMs, SINE_LOOKUP_SZ), PERIOD_MS);
+	uint16_t const out = DIV(MUL((uint32_t)amplitude, LOAD(sineLookup[idx])), 0xFFFF);
+	*curTimeMs = ALU(*curTimeMs + 1);
+	return out;
+}
+
+static uint16_t old_sawtooth(uint32_t *curTimeMs, uint16_t amplitude)
+{
+	if (BRANCH(LOAD(*curTimeMs) >= PERIOD_MS)) {
+		*curTimeMs = 0;
+	}
+	uint16_t const out = DIV(MUL((uint32_t)amplitude, *curTimeMs), PERIOD_MS - 1);
+	*curTimeMs = ALU(*curTimeMs + 1);
+	return out;
+}
+
+static uint16_t old_triangle(uint32_t *curTimeMs, uint16_t amplitude)
+{
+	if (BRANCH(LOAD(*curTimeMs) >= PERIOD_MS)) {
+		*curTimeMs = 0;
+	}
+	uint16_t out;
+	if (BRANCH(*curTimeMs <= PERIOD_MS / 2)) {
+		out = DIV(MUL((uint32_t)amplitude, *curTimeMs), PERIOD_MS / 2);
+	} else {
+		out = DIV(MUL((uint32_t)amplitude, ALU(PERIOD_MS - *curTimeMs)), PERIOD_MS / 2);
+	}
+	*curTimeMs = ALU(*curTimeMs + 1);
+	return out;
+}
+
+// DDS sample functions, dds_next, dds_sine_quarter, dds_ramp, dds_triangle and dds_scale with each operation counted
+
+static uint32_t next(uint32_t *phase, uint32_t tuningWord)
+{
+	uint32_t const cur = LOAD(*phase);
+	*phase = ALU(cur + tuningWord);
+	return cur;
+}
+
+static uint16_t scale(uint32_t sample, uint32_t ampScale)
+{
+	return ALU(ALU(MUL((uint64_t)sample, ampScale) + 0xFFFF) >> 32);
+}
+
+static uint16_t new_sine(uint32_t *phase, uint32_t tuningWord, uint32_t ampScale)
+{
+	uint32_t const curPhase = next(phase, tuningWord);
+	uint32_t const quarter = ALU(curPhase >> 30);
+	uint32_t quarterPhase = ALU(curPhase & 0x3FFFFFFF);
+	if (BRANCH(quarter & 1)) {
+		quarterPhase = ALU(0x3FFFFFFF - quarterPhase);
+	}
+	uint32_t const idx = ALU(quarterPhase >> (30 - QUARTER_BITS));
+	uint32_t const frac = ALU(ALU(quarterPhase >> (14 - QUARTER_BITS)) & 0xFFFF);
+	uint32_t const lo = LOAD(quarterTable[idx]);
+	uint32_t const value = ALU(lo + ALU(MUL(ALU(LOAD(quarterTable[idx + 1]) - lo), frac) >> 16));
+	uint32_t const sample = BRANCH(quarter < 2) ? ALU(ALU(0x10000 + value) >> 1) : ALU(ALU(0x10000 - value) >> 1);
+	return scale(sample, ampScale);
+}
+
+static uint16_t new_sawtooth(uint32_t *phase, uint32_t tuningWord, uint32_t ampScale)
+{
+	return scale(ALU(next(phase, tuningWord) >> 16), ampScale);
+}
+
+static uint16_t new_triangle(uint32_t *phase, uint32_t tuningWord, uint32_t ampScale)
+{
+	uint32_t curPhase = next(phase, tuningWord);
+	if (BRANCH(curPhase & 0x80000000)) {
+		curPhase = ALU(~curPhase);
+	}
+	return scale(ALU(curPhase >> 15), ampScale);
+}
+
+typedef uint16_t (*old_sample_t)(uint32_t *curTimeMs, uint16_t amplitude);
+typedef uint16_t (*new_sample_t)(uint32_t *phase, uint32_t tuningWord, uint32_t ampScale);
+
+/** One waveform, its old callback and its counted DDS sample. */
+typedef struct {
+	char const *name;
+	waveform_ops_t const *ops;
+	old_sample_t oldSample;
+	new_sample_t newSample;
+} wave_t;
+
+/** Prints the operations of one period averaged per sample. */
+static void per_sample(ops_t const *total, uint32_t samples)
+{
+	printf(" %5.2f div %5.2f mul %5.2f alu %5.2f load %5.2f branch |",
+		(double)total->div / samples, (double)total->mul / samples, (double)total->alu / samples,
+		(double)total->load / samples, (double)total->branch / samples);
+}
+
+/** Counts a period of the old and new samples, and checks the new ones against the port. */
+static void test_wave(wave_t const *wave)
+{
+	uint16_t const amplitude = SCALE_AMPLITUDE(AMPLITUDE);
+	printf("%-8s", wave->name);
+
+	memset(&ops, 0, sizeof(ops));
+	uint32_t curTimeMs = 0;
+	for (uint32_t i = 0; i < PERIOD_MS; ++i) {
+		wave->oldSample(&curTimeMs, amplitude);
+	}
+	ops_t const old = ops;
+	per_sample(&old, PERIOD_MS);
+
+	memset(&ops, 0, sizeof(ops));
+	uint16_t expected[RENDER_LEN];
+	uint32_t phase = 0;
+	uint32_t const tuningWord = dds_tuning_word_len(RENDER_LEN, 1);
+	for (uint32_t i = 0; i < RENDER_LEN; ++i) {
+		expected[i] = wave->newSample(&phase, tuningWord, dds_amplitude_scale(amplitude));
+	}
+	ops_t const dds = ops;
+	per_sample(&dds, RENDER_LEN);
+	printf("\n");
+
+	CHECK(old.div >= PERIOD_MS);
+	CHECK_EQ(dds.div, 0);
+
+	// the port gets the same samples from the firmware, 1 kHz at 100 kSPS loops one period of RENDER_LEN
+	mock_reset();
+	wave_out_init();
+	wave->ops->init();
+	waveform_batch_t batch = {0};
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_AMPLITUDE, AMPLITUDE });
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_SAMPLE_RATE, 100000 });
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_FREQ_MHZ, 1000000 });
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_ENABLE, 1 });
+	wave->ops->set(&batch);
+
+	wave_out_status_t status;
+	wave_out_get_status(&status);
+	CHECK_EQ(status.mode, WAVE_OUT_TABLE);
+	CHECK_EQ(status.len, RENDER_LEN);
+
+	mock_tim_step(2);
+	CHECK_EQ(GPIOB->ODR, expected[0]);
+	for (uint32_t i = 1; i < RENDER_LEN; ++i) {
+		mock_tim_until_update(2);
+		CHECK_EQ(GPIOB->ODR, expected[i]);
+	}
+
+	waveform_batch_t stop = {0};
+	waveform_batch_add(&stop, (waveform_cfg_t){ PARAM_ENABLE, 0 });
+	wave->ops->set(&stop);
+}
+
+int main(void)
+{
+	test_scale_exact();
+
+	for (uint32_t i = 0; i < SINE_LOOKUP_SZ; ++i) {
+		sineLookup[i] = lround(32767.5 + 32767.5 * sin(2 * M_PI * i / SINE_LOOKUP_SZ));
+	}
+	for (uint32_t i = 0; i <= (1 << QUARTER_BITS); ++i) {
+		quarterTable[i] = lround(0xFFFF * sin(M_PI / 2 * i / (1 << QUARTER_BITS)));
+	}
+
+	static wave_t const waves[] = {
+		{ "sine", &sine_wave_ops, old_sine, new_sine },
+		{ "sawtooth", &sawtooth_wave_ops, old_sawtooth, new_sawtooth },
+		{ "triangle", &triangle_wave_ops, old_triangle, new_triangle },
+	};
+	printf("ops per sample, old 1ms callback | DDS sample\n");
+	for (uint32_t i = 0; i < sizeof(waves) / sizeof(waves[0]); ++i) {
+		test_wave(&waves[i]);
+	}
+	return test_result("scale");
+}
@@ -0,0 +1,184 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Accuracy of the interpolated quarter-wave sine against sin().
+ * Reports the max error in LSBs and the THD of one period, over the 2nd to 10th harmonics,
+ * for quarter tables of several sizes folded and interpolated by dds_sine_quarter, and
+ * for the full period table of 1000 entries without interpolation it replaced.
+ * Then checks the sine the waveform actually puts on the port.
+ */
+
+#include "dds.h"
+#include "mock.h"
+#include "sine_wave.h"
+#include "test.h"
+#include "wave_out.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define MAX_BITS		10
+#define NUM_HARMONICS	10
+// the old table, a full period without interpolation
+#define FULL_TABLE_LEN	1000
+
+// midpoint and peak of a full scale sine
+#define MID		32768.0
+#define PEAK	32767.5
+
+/** Error of one period of samples against the ideal sine. */
+typedef struct {
+	/** Largest difference from the ideal sine, in LSBs */
+	double maxError;
+	/** Total harmonic distortion, in dB below the fundamental */
+	double thdDb;
+} accuracy_t;
+
+static uint16_t quarterTable[(1 << MAX_BITS) + 1];
+static uint16_t fullTable[FULL_TABLE_LEN];
+
+/** Builds a quarter table of 2^bits steps the way the firmware's was, plus the peak at the end. */
+static void build_quarter(uint8_t bits)
+{
+	uint32_t const len = 1 << bits;
+	for (uint32_t i = 0; i <= len; ++i) {
+		quarterTable[i] = lround(0xFFFF * sin(M_PI / 2 * i / len));
+	}
+}
+
+/** Measures one period of len samples. */
+static accuracy_t measure(uint16_t const *samples, uint32_t len)
+{
+	accuracy_t result = { 0, 0 };
+	double harmonics[NUM_HARMONICS + 1] = { 0 };
+	for (uint32_t i = 0; i < len; ++i) {
+		double const error = fabs(samples[i] - (MID + PEAK * sin(2 * M_PI * i / len)));
+		if (error > result.maxError) {
+			result.maxError = error;
+		}
+	}
+	// the period is exact, so each harmonic lands in one DFT bin
+	for (uint32_t h = 1; h <= NUM_HARMONICS; ++h) {
+		double re = 0;
+		double im = 0;
+		for (uint32_t i = 0; i < len; ++i) {
+			double const angle = 2 * M_PI * h * (double)i / len;
+			re += (samples[i] - MID) * cos(angle);
+			im += (samples[i] - MID) * sin(angle);
+		}
+		harmonics[h] = re * re + im * im;
+	}
+	double distortion = 0;
+	for (uint32_t h = 2; h <= NUM_HARMONICS; ++h) {
+		distortion += harmonics[h];
+	}
+	result.thdDb = 10 * log10(distortion / harmonics[1] + 1e-30);
+	return result;
+}
+
+/** Generates one period of len samples from a quarter table of 2^bits steps. */
+static accuracy_t quarter_period(uint8_t bits, uint32_t len, uint16_t *samples)
+{
+	uint32_t const tuningWord = dds_tuning_word_len(len, 1);
+	uint32_t phase = 0;
+	for (uint32_t i = 0; i < len; ++i) {
+		samples[i] = dds_sine_quarter(quarterTable, bits, dds_next(&phase, tuningWord));
+	}
+	return measure(samples, len);
+}
+
+/** Generates one period of len samples from the full table, stepping through it by the nearest entry. */
+static accuracy_t full_period(uint32_t len, uint16_t *samples)
+{
+	for (uint32_t i = 0; i < len; ++i) {
+		samples[i] = fullTable[(uint64_t)i * FULL_TABLE_LEN / len];
+	}
+	return measure(samples, len);
+}
+
+static void test_tables(void)
+{
+	static uint32_t const lens[] = { 100, 1000, 10000, 100000 };
+	uint16_t *samples = malloc(100000 * sizeof(*samples));
+
+	for (uint32_t i = 0; i < FULL_TABLE_LEN; ++i) {
+		fullTable[i] = lround(MID + PEAK * sin(2 * M_PI * i / FULL_TABLE_LEN) - 0.5);
+	}
+
+	printf("%-24s", "table");
+	for (uint32_t j = 0; j < sizeof(lens) / sizeof(lens[0]); ++j) {
+		printf("  %6u samples/period ", lens[j]);
+	}
+	printf("\n");
+
+	for (uint8_t bits = 6; bits <= MAX_BITS; ++bits) {
+		build_quarter(bits);
+		char name[32];
+		snprintf(name, sizeof(name), "quarter %u + interp", 1 << bits);
+		printf("%-24s", name);
+		for (uint32_t j = 0; j < sizeof(lens) / sizeof(lens[0]); ++j) {
+			accuracy_t const result = quarter_period(bits, lens[j], samples);
+			printf("  %5.2f LSB %6.1f dB ", result.maxError, result.thdDb);
+			if (bits == 8) {
+				// the firmware's size, the error grows at long periods as the rounded tuning word drifts
+				CHECK(result.maxError < 2.5);
+				CHECK(result.thdDb < -80);
+			}
+		}
+		printf("\n");
+	}
+
+	printf("%-24s", "full 1000, no interp");
+	for (uint32_t j = 0; j < sizeof(lens) / sizeof(lens[0]); ++j) {
+		accuracy_t const full = full_period(lens[j], samples);
+		printf("  %5.2f LSB %6.1f dB ", full.maxError, full.thdDb);
+		// past 1000 samples a period the old table repeats entries, the quarter table keeps interpolating,
+		// the steps that leaves are spread far above the 10th harmonic so only the error shows them
+		if (lens[j] > FULL_TABLE_LEN) {
+			build_quarter(8);
+			accuracy_t const quarter = quarter_period(8, lens[j], samples);
+			CHECK(quarter.maxError * 10 < full.maxError);
+		}
+	}
+	printf("\n");
+	free(samples);
+}
+
+/** The sine waveform at full amplitude on the port, from a 500 sample table. */
+static void test_output(void)
+{
+	mock_reset();
+	wave_out_init();
+	sine_wave_ops.init();
+	waveform_batch_t batch = {0};
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_SAMPLE_RATE, 500000 });
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_FREQ_MHZ, 1000000 });
+	waveform_batch_add(&batch, (waveform_cfg_t){ PARAM_ENABLE, 1 });
+	sine_wave_ops.set(&batch);
+
+	wave_out_status_t status;
+	wave_out_get_status(&status);
+	CHECK_EQ(status.mode, WAVE_OUT_TABLE);
+	CHECK_EQ(status.len, 500);
+
+	uint16_t samples[500];
+	mock_tim_step(2);
+	samples[0] = GPIOB->ODR;
+	for (uint32_t i = 1; i < 500; ++i) {
+		mock_tim_until_update(2);
+		samples[i] = GPIOB->ODR;
+	}
+	accuracy_t const result = measure(samples, 500);
+	printf("sine waveform on the port, 500 samples/period: %.2f LSB %.1f dB\n", result.maxError, result.thdDb);
+	CHECK(result.maxError < 2.5);
+	CHECK(result.thdDb < -80);
+}
+
+int main(void)
+{
+	test_tables();
+	test_output();
+	return test_result("sine");
+}
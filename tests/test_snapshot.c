@@ -0,0 +1,218 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Stress test of the lock-free snapshot.
+ * One writer thread publishes values whose words all follow from a counter while reader
+ * threads copy them as fast as they can, on as many host cores as there are. Every copy a
+ * reader accepts has to be one whole published value, never newer than the last publish
+ * started and never older than one it already saw.
+ * The same is checked deterministically by preempting the reader or writer at each of their barriers.
+ */
+
+#include "mock.h"
+#include "snapshot.h"
+#include "test.h"
+#include <pthread.h>
+#include <time.h>
+
+#define NUM_READERS		3
+#define NUM_PUBLISHES	2000000
+
+/** A value filling a snapshot, every word is tied to the first. */
+typedef struct {
+	uint32_t count;
+	uint32_t words[SNAPSHOT_MAX_SZ / 4 - 1];
+} value_t;
+SNAPSHOT_CHECK_SIZE(value_t);
+
+static snapshot_t snap;
+static volatile uint32_t bDone = 0;
+
+/** Returns the value published for count. */
+static value_t make_value(uint32_t count)
+{
+	value_t value;
+	value.count = count;
+	for (uint32_t i = 0; i < sizeof(value.words) / sizeof(value.words[0]); ++i) {
+		value.words[i] = count * 2654435761u + i;
+	}
+	return value;
+}
+
+/** Results of one reader. */
+typedef struct {
+	uint64_t reads;
+	uint64_t retries;
+	uint64_t torn;
+	uint64_t backwards;
+} reader_t;
+
+static void *writer(void *arg)
+{
+	for (uint32_t count = 1; count <= NUM_PUBLISHES; ++count) {
+		value_t const value = make_value(count);
+		snapshot_publish(&snap, &value, sizeof(value));
+	}
+	bDone = 1;
+	return NULL;
+}
+
+static void *reader(void *arg)
+{
+	reader_t *result = arg;
+	uint32_t last = 0;
+	while (!bDone) {
+		value_t value;
+		if (!snapshot_try_read(&snap, &value)) {
+			++result->retries;
+			continue;
+		}
+		value_t const want = make_value(value.count);
+		if (memcmp(&value, &want, sizeof(value)) != 0) {
+			++result->torn;
+		}
+		if (value.count < last) {
+			++result->backwards;
+		}
+		last = value.count;
+		++result->reads;
+	}
+	return NULL;
+}
+
+// snapshot the interleaving tests use, and the value a preempting reader got
+static snapshot_t local;
+static value_t preemptValue;
+static uint8_t bPreemptOk;
+// what the hook does at the next barriers, and whether it's running
+static uint32_t hookPublishes;
+static uint32_t hookCount;
+static uint8_t bInHook;
+
+/** Reads the snapshot at each barrier of a publish, as an interrupt would. */
+static void read_at_barrier(void)
+{
+	if (bInHook) {
+		return;
+	}
+	bInHook = 1;
+	++hookCount;
+	bPreemptOk = snapshot_try_read(&local, &preemptValue);
+	bInHook = 0;
+}
+
+/** Publishes hookPublishes new values at one barrier of a read, as a writer lapping it would. */
+static void publish_at_barrier(void)
+{
+	if (bInHook) {
+		return;
+	}
+	bInHook = 1;
+	if (++hookCount == hookPublishes >> 8) {
+		for (uint32_t i = 0; i < (hookPublishes & 0xFF); ++i) {
+			value_t const value = make_value(100 + i);
+			snapshot_publish(&local, &value, sizeof(value));
+		}
+	}
+	bInHook = 0;
+}
+
+/** A read that preempts a publish at either of its barriers gets the whole value from before it. */
+static void test_preempt_writer(void)
+{
+	memset(&local, 0, sizeof(local));
+	value_t const old = make_value(7);
+	snapshot_publish(&local, &old, sizeof(old));
+
+	for (uint32_t i = 0; i < 4; ++i) {
+		value_t const prev = make_value(7 + i);
+		value_t const next = make_value(8 + i);
+		hookCount = 0;
+		mock_barrier_hook = read_at_barrier;
+		snapshot_publish(&local, &next, sizeof(next));
+		mock_barrier_hook = NULL;
+		CHECK_EQ(hookCount, 2);
+		CHECK(bPreemptOk);
+		CHECK(memcmp(&preemptValue, &prev, sizeof(prev)) == 0);
+
+		value_t value;
+		snapshot_read(&local, &value);
+		CHECK(memcmp(&value, &next, sizeof(next)) == 0);
+	}
+}
+
+/**
+ * A writer that laps a read at either of its barriers makes it fail, unless the slot
+ * it copied is still intact. A read that succeeds always has a whole published value.
+ */
+static void test_lap_reader(void)
+{
+	for (uint32_t barrier = 1; barrier <= 2; ++barrier) {
+		for (uint32_t publishes = 1; publishes <= 3; ++publishes) {
+			memset(&local, 0, sizeof(local));
+			value_t const old = make_value(7);
+			snapshot_publish(&local, &old, sizeof(old));
+
+			hookCount = 0;
+			hookPublishes = (barrier << 8) | publishes;
+			mock_barrier_hook = publish_at_barrier;
+			value_t value;
+			uint8_t const bOk = snapshot_try_read(&local, &value);
+			mock_barrier_hook = NULL;
+
+			value_t const want = make_value(value.count);
+			if (bOk) {
+				CHECK(memcmp(&value, &want, sizeof(value)) == 0);
+			}
+			// one publish writes the other slot, any more overwrite the one being read
+			CHECK_EQ(bOk, publishes == 1);
+		}
+	}
+}
+
+static void test_stress(void)
+{
+	value_t const first = make_value(0);
+	snapshot_publish(&snap, &first, sizeof(first));
+
+	struct timespec start;
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	reader_t results[NUM_READERS] = {{0}};
+	pthread_t readers[NUM_READERS];
+	for (int i = 0; i < NUM_READERS; ++i) {
+		pthread_create(&readers[i], NULL, reader, &results[i]);
+	}
+	pthread_t writerThread;
+	pthread_create(&writerThread, NULL, writer, NULL);
+	pthread_join(writerThread, NULL);
+
+	reader_t total = {0};
+	for (int i = 0; i < NUM_READERS; ++i) {
+		pthread_join(readers[i], NULL);
+		total.reads += results[i].reads;
+		total.retries += results[i].retries;
+		total.torn += results[i].torn;
+		total.backwards += results[i].backwards;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	CHECK(total.reads > 0);
+	CHECK_EQ(total.torn, 0);
+	CHECK_EQ(total.backwards, 0);
+	printf("%u publishes, %llu reads by %u readers, %llu lapped and retried, %llu torn, %.2f s\n",
+		NUM_PUBLISHES, (unsigned long long)total.reads, NUM_READERS, (unsigned long long)total.retries,
+		(unsigned long long)total.torn, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+}
+
+int main(void)
+{
+	test_preempt_writer();
+	test_lap_reader();
+	test_stress();
+	return test_result("snapshot");
+}
@@ -0,0 +1,93 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Tests the stack high-water marks on a host thread.
+ * The thread runs on a buffer painted the way RTX paints a thread stack, and uses its
+ * stack down to a known word. Everything below that word has to be reported free, and a
+ * stack whose bottom word was overwritten has to be reported as unknown.
+ */
+
+#include "stack_watch.h"
+#include "test.h"
+#include <pthread.h>
+#include <string.h>
+
+// the host needs a much bigger stack than the target to start a thread on
+#define STACK_WORDS	16384
+
+static uint32_t stack[STACK_WORDS] __attribute__((aligned(64)));
+// lowest word the thread wrote
+static uint32_t const *volatile lowest;
+
+/** Paints the stack the way RTX does when it creates a thread. */
+static void paint(void)
+{
+	for (uint32_t i = 0; i < STACK_WORDS; ++i) {
+		stack[i] = STACK_WATCH_PAINT;
+	}
+	stack[0] = STACK_WATCH_BOTTOM;
+}
+
+/** Uses the stack down to about arg words above the bottom, and records the lowest word written. */
+static void *use_stack(void *arg)
+{
+	stack_watch_register(STACK_WATCH_WAVEFORM);
+
+	uint32_t const leave = *(uint32_t const *)arg;
+	uint32_t here = 0;
+	uint32_t const len = (uint32_t)(&here - stack) - leave;
+	volatile uint32_t buf[len];
+	for (uint32_t i = 0; i < len; ++i) {
+		buf[i] = i;
+	}
+	lowest = (uint32_t const *)&buf[0];
+	return NULL;
+}
+
+/** Runs use_stack on the painted stack until it's done. */
+static void run_on_stack(uint32_t leave)
+{
+	paint();
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	CHECK_EQ(pthread_attr_setstack(&attr, stack, sizeof(stack)), 0);
+	pthread_t thread;
+	CHECK_EQ(pthread_create(&thread, &attr, use_stack, &leave), 0);
+	pthread_join(thread, NULL);
+	pthread_attr_destroy(&attr);
+}
+
+int main(void)
+{
+	// nothing is known about a thread until its bottom is set, registering doesn't search the host stack
+	CHECK_EQ(stack_watch_free_words(STACK_WATCH_WAVEFORM), -1);
+	run_on_stack(STACK_WORDS / 2);
+	CHECK_EQ(stack_watch_free_words(STACK_WATCH_WAVEFORM), -1);
+
+	stack_watch_set_bottom(STACK_WATCH_WAVEFORM, stack);
+
+	// the paint left is counted up to the limit
+	run_on_stack(STACK_WORDS / 2);
+	CHECK_EQ(stack_watch_free_words(STACK_WATCH_WAVEFORM), STACK_WATCH_MAX_WORDS);
+
+	// down to a known word, the words between it and the bottom are free
+	static uint32_t const leaves[] = { 200, 100, 40 };
+	for (uint32_t i = 0; i < sizeof(leaves) / sizeof(leaves[0]); ++i) {
+		run_on_stack(leaves[i]);
+		int32_t const expected = (int32_t)(lowest - stack) - 1;
+		CHECK(expected >= 0 && expected < STACK_WATCH_MAX_WORDS);
+		CHECK_EQ(stack_watch_free_words(STACK_WATCH_WAVEFORM), expected);
+		printf("stack used down to %d words above the bottom, %d reported free\n",
+			expected + 1, stack_watch_free_words(STACK_WATCH_WAVEFORM));
+	}
+
+	// the thread reached the bottom word, the rest can't be trusted
+	stack[0] = 0;
+	CHECK_EQ(stack_watch_free_words(STACK_WATCH_WAVEFORM), -1);
+	CHECK_EQ(stack_watch_free_words(STACK_WATCH_UART), -1);
+	CHECK(strcmp(stack_watch_name(STACK_WATCH_WAVEFORM), "waveform") == 0);
+	return test_result("stack_watch");
+}
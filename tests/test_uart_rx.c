@@ -0,0 +1,193 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Feeds 64 KB bursts through the DMA receive ring, against the simulated DMA1 channel 5.
+ * The line delivers one character per step at full baud, back to back, and goes idle
+ * between bursts. The reader is the UART thread reading one character at a time. While
+ * it waits on its signal the line keeps going, and once woken it only gets to run after
+ * a number of character times, as if higher priority work was in the way. Every character
+ * has to arrive in order, and any the reader fell too far behind to keep are counted.
+ */
+
+#include "cmsis_os.h"
+#include "metrics.h"
+#include "mock.h"
+#include "test.h"
+#include "uart_rx.h"
+#include <string.h>
+
+#define BURST_LEN	65536
+#define NUM_BURSTS	3
+// character times the line stays idle after each burst
+#define IDLE_STEPS	4
+
+// the reading thread, only its id is used
+static osThreadId const self = (osThreadId)0x2000;
+static int32_t signals = 0;
+
+// characters the line sends, and the next one
+static uint32_t sent = 0;
+static uint32_t toSend = 0;
+static uint32_t idleLeft = 0;
+// character times a woken reader takes to start running
+static uint32_t wakeSteps = 0;
+// interrupts run while receiving
+static uint32_t irqs = 0;
+
+/** The character the line sends at position i, so a lost or repeated one shows. */
+static char stream(uint32_t i)
+{
+	return (char)(i * 31 + (i >> 9));
+}
+
+/**
+ * Moves the line on one character time: the next character of the burst, or the idle
+ * line after it. Runs the interrupts it caused. Returns zero once the line has nothing left.
+ */
+static uint8_t line_step(void)
+{
+	if (sent < toSend) {
+		USART1->DR = (uint8_t)stream(sent++);
+		USART1->SR |= USART_SR_RXNE;
+		// the DMA takes the character straight away, reading DR clears RXNE
+		if ((USART1->CR3 & USART_CR3_DMAR) && mock_dma_request(5)) {
+			USART1->SR &= ~USART_SR_RXNE;
+		}
+		if (sent == toSend) {
+			idleLeft = IDLE_STEPS;
+		}
+	} else if (idleLeft != 0) {
+		// a whole character time of idle line after the last character
+		if (idleLeft-- == IDLE_STEPS && (USART1->CR1 & USART_CR1_IDLEIE)) {
+			USART1->SR |= USART_SR_IDLE;
+			NVIC->ISPR[USART1_IRQn / 32] |= 1UL << (USART1_IRQn % 32);
+		}
+	} else {
+		return 0;
+	}
+	irqs += mock_irq_run();
+	// the handler read SR then DR, which clears the idle flag
+	USART1->SR &= ~USART_SR_IDLE;
+	return 1;
+}
+
+osThreadId osThreadGetId(void)
+{
+	return self;
+}
+
+int32_t osSignalSet(osThreadId thread_id, int32_t set)
+{
+	CHECK(thread_id == self);
+	int32_t const prev = signals;
+	signals |= set;
+	return prev;
+}
+
+int32_t osSignalClear(osThreadId thread_id, int32_t clear)
+{
+	int32_t const prev = signals;
+	signals &= ~clear;
+	return prev;
+}
+
+osEvent osSignalWait(int32_t wait, uint32_t millisec)
+{
+	// the line keeps going while the reader sleeps, and for a while after it's woken
+	while (!(signals & wait) && line_step()) {
+	}
+	for (uint32_t i = 0; i < wakeSteps && line_step(); ++i) {
+	}
+	osEvent event = { osEventSignal, { .signals = signals & wait } };
+	signals &= ~wait;
+	return event;
+}
+
+/** Result of receiving the bursts. */
+typedef struct {
+	uint32_t read;
+	uint32_t dropped;
+	uint32_t outOfOrder;
+	uint32_t maxDepth;
+} result_t;
+
+/** Sends the bursts with the reader woken wake character times late, and reads them back. */
+static result_t receive(uint32_t wake)
+{
+	result_t result = {0};
+	wakeSteps = wake;
+	metrics_reset();
+	irqs = 0;
+
+	for (uint32_t burst = 0; burst < NUM_BURSTS; ++burst) {
+		toSend += BURST_LEN;
+		// the reader is waiting when the burst starts
+		uint32_t next = sent;
+		while (next < toSend) {
+			char const c = uart_rx_getc();
+			uint32_t dropped;
+			uint32_t max;
+			metrics_read(METRIC_UART_RX_DROPS, &dropped, &max);
+			// whatever is read follows on from the last character, apart from what was counted as dropped
+			if (c != stream(next + (dropped - result.dropped))) {
+				++result.outOfOrder;
+			}
+			next += 1 + (dropped - result.dropped);
+			result.dropped = dropped;
+			++result.read;
+		}
+		// let the line go idle
+		while (line_step()) {
+		}
+		CHECK_EQ(uart_rx_read(&(char){0}, 1), 0);
+	}
+
+	uint32_t depth;
+	metrics_read(METRIC_UART_RX_DEPTH, &depth, &result.maxDepth);
+	return result;
+}
+
+static void test_init(void)
+{
+	mock_reset();
+	uart_rx_init();
+	mock_sync();
+	CHECK(RCC->AHBENR & RCC_AHBENR_DMA1EN);
+	CHECK(USART1->CR3 & USART_CR3_DMAR);
+	CHECK(USART1->CR1 & USART_CR1_IDLEIE);
+	CHECK_EQ(DMA1_Channel5->CPAR, (uint32_t)&USART1->DR);
+	CHECK_EQ(DMA1_Channel5->CNDTR, UART_RX_LEN);
+	CHECK(DMA1_Channel5->CCR & DMA_CCR1_CIRC);
+	CHECK(NVIC->ISER[0] & (1UL << DMA1_Channel5_IRQn));
+	CHECK(NVIC->ISER[USART1_IRQn / 32] & (1UL << (USART1_IRQn % 32)));
+	// neither can hold off the stream refill
+	CHECK(NVIC->IP[DMA1_Channel5_IRQn] > 0);
+	CHECK(NVIC->IP[USART1_IRQn] > 0);
+}
+
+int main(void)
+{
+	test_init();
+
+	// woken within a character, within 150, and too late for the half ring interrupt to save it
+	static uint32_t const wakes[] = { 0, 150, 250 };
+	for (uint32_t i = 0; i < sizeof(wakes) / sizeof(wakes[0]); ++i) {
+		result_t const result = receive(wakes[i]);
+		printf("%u x %u bytes, reader woken %3u characters late: %u read, %u dropped, %u out of order, "
+			"max %u unread, %u interrupts\n", NUM_BURSTS, BURST_LEN, wakes[i], result.read, result.dropped,
+			result.outOfOrder, result.maxDepth, irqs);
+		CHECK_EQ(result.outOfOrder, 0);
+		CHECK_EQ(result.read + result.dropped, NUM_BURSTS * BURST_LEN);
+		if (wakes[i] <= 150) {
+			CHECK_EQ(result.dropped, 0);
+			// half ring interrupts and one idle interrupt per burst, not one per character
+			CHECK(irqs <= NUM_BURSTS * (2 * BURST_LEN / UART_RX_LEN + 1));
+		} else {
+			CHECK(result.dropped > 0);
+		}
+	}
+	return test_result("uart_rx");
+}
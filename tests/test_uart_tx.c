@@ -0,0 +1,279 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Tests the DMA transmit ring against the simulated DMA1 channel 4.
+ * The line takes one character per step, through the channel when USART1 requests DMA.
+ * A sender waiting on its signal keeps the line running until the interrupt wakes it,
+ * as the RTOS would by running other threads while it sleeps.
+ */
+
+#include "cmsis_os.h"
+#include "metrics.h"
+#include "mock.h"
+#include "test.h"
+#include "uart_tx.h"
+#include <string.h>
+
+// longest text sent at once, well over the ring
+#define MAX_TEXT	4096
+// character times a woken sender takes to get back to writing, for the switch to its thread
+#define WAKE_STEPS	2
+
+// the sending thread, only its id is used
+static osThreadId const self = (osThreadId)0x1000;
+static int32_t signals = 0;
+static uint32_t waits = 0;
+
+// characters the line sent, and the line steps that didn't send one while the sender had more
+static char line[MAX_TEXT * 2];
+static uint32_t lineLen = 0;
+static uint32_t idleSteps = 0;
+
+/** Sends one character time on the line, then runs the interrupts it caused. Returns non-zero if one was sent. */
+static uint8_t line_step(void)
+{
+	uint8_t bSent = 0;
+	if ((USART1->CR3 & USART_CR3_DMAT) && mock_dma_request(4)) {
+		line[lineLen++] = (char)USART1->DR;
+		bSent = 1;
+	}
+	mock_irq_run();
+	return bSent;
+}
+
+/** Runs the line until the DMA is idle and nothing is pending, returns the characters sent. */
+static uint32_t line_drain(void)
+{
+	uint32_t const start = lineLen;
+	mock_irq_run();
+	while (line_step()) {
+	}
+	return lineLen - start;
+}
+
+osThreadId osThreadGetId(void)
+{
+	return self;
+}
+
+int32_t osSignalSet(osThreadId thread_id, int32_t set)
+{
+	CHECK(thread_id == self);
+	int32_t const prev = signals;
+	signals |= set;
+	return prev;
+}
+
+int32_t osSignalClear(osThreadId thread_id, int32_t clear)
+{
+	int32_t const prev = signals;
+	signals &= ~clear;
+	return prev;
+}
+
+osEvent osSignalWait(int32_t wait, uint32_t millisec)
+{
+	// the line keeps going while the sender sleeps, it has to be woken before the ring runs dry
+	++waits;
+	// an interrupt the sender pended ran as soon as it was pended
+	mock_irq_run();
+	while (!(signals & wait)) {
+		if (!line_step()) {
+			// nothing left to send and nobody woke the sender
+			++idleSteps;
+			CHECK(0);
+			break;
+		}
+	}
+	for (uint32_t i = 0; i < WAKE_STEPS; ++i) {
+		if (!line_step()) {
+			++idleSteps;
+		}
+	}
+	osEvent event = { osEventSignal, { .signals = signals & wait } };
+	signals &= ~wait;
+	return event;
+}
+
+static void test_init(void)
+{
+	mock_reset();
+	uart_tx_init();
+	// let the clear of the pending interrupt take effect before anything sets it again
+	mock_sync();
+	CHECK(RCC->AHBENR & RCC_AHBENR_DMA1EN);
+	CHECK(USART1->CR3 & USART_CR3_DMAT);
+	CHECK_EQ(DMA1_Channel4->CPAR, (uint32_t)&USART1->DR);
+	CHECK_EQ(DMA1_Channel4->CCR, 0);
+	CHECK_EQ(NVIC->IP[DMA1_Channel4_IRQn], 0x80);
+	CHECK(NVIC->ISER[0] & (1UL << DMA1_Channel4_IRQn));
+}
+
+/** A write only pends the interrupt, which starts one run of the whole text. */
+static void test_single_run(void)
+{
+	lineLen = 0;
+	CHECK_EQ(uart_tx_write("hello", 5), 5);
+	CHECK_EQ(DMA1_Channel4->CCR, 0);
+	CHECK(mock_irq_pending(DMA1_Channel4_IRQn));
+
+	mock_irq_run();
+	CHECK_EQ(DMA1_Channel4->CNDTR, 5);
+	CHECK_EQ(DMA1_Channel4->CCR, DMA_CCR1_MINC | DMA_CCR1_DIR | DMA_CCR1_TCIE | DMA_CCR1_EN);
+
+	CHECK_EQ(line_drain(), 5);
+	CHECK(memcmp(line, "hello", 5) == 0);
+	// the transfer complete interrupt found nothing more and left the channel off
+	CHECK_EQ(DMA1_Channel4->CCR, 0);
+	CHECK(!mock_irq_pending(DMA1_Channel4_IRQn));
+}
+
+/** Text written while a run is in progress waits for it, and goes out in the next run. */
+static void test_write_while_busy(void)
+{
+	lineLen = 0;
+	uart_tx_write("abcdef", 6);
+	mock_irq_run();
+	line_step();
+	line_step();
+	uint32_t const cmar = DMA1_Channel4->CMAR;
+
+	uart_tx_write("XYZ", 3);
+	mock_irq_run();
+	// the pended interrupt didn't touch the run in progress
+	CHECK_EQ(DMA1_Channel4->CNDTR, 4);
+	CHECK_EQ(DMA1_Channel4->CMAR, cmar);
+
+	line_step();
+	line_step();
+	line_step();
+	line_step();
+	// the last character's transfer complete started the next run straight away
+	CHECK_EQ(DMA1_Channel4->CNDTR, 3);
+	CHECK_EQ(DMA1_Channel4->CMAR, cmar + 6);
+	CHECK_EQ(line_drain(), 3);
+	CHECK_EQ(lineLen, 9);
+	CHECK(memcmp(line, "abcdefXYZ", 9) == 0);
+}
+
+/** A run stops at the end of the ring, the rest goes out in a second run from the start. */
+static void test_wrap(void)
+{
+	char text[UART_TX_LEN];
+	for (uint32_t i = 0; i < sizeof(text); ++i) {
+		text[i] = 'a' + i % 26;
+	}
+
+	// the earlier tests left the ring 14 characters in, fill it up to 10 before the end
+	lineLen = 0;
+	CHECK_EQ(uart_tx_write(text, UART_TX_LEN - 14 - 10), UART_TX_LEN - 24);
+	line_drain();
+	CHECK_EQ(lineLen, UART_TX_LEN - 24);
+
+	lineLen = 0;
+	uart_tx_write(text, 30);
+	mock_irq_run();
+	CHECK_EQ(DMA1_Channel4->CNDTR, 10);
+	uint32_t const end = DMA1_Channel4->CMAR + 10;
+	for (uint32_t i = 0; i < 10; ++i) {
+		line_step();
+	}
+	CHECK_EQ(DMA1_Channel4->CNDTR, 20);
+	CHECK_EQ(DMA1_Channel4->CMAR, end - UART_TX_LEN);
+	line_drain();
+	CHECK_EQ(lineLen, 30);
+	CHECK(memcmp(line, text, 30) == 0);
+}
+
+/** Writing never waits, it queues what fits. Room is only made as each run completes. */
+static void test_full(void)
+{
+	char text[UART_TX_LEN + 16];
+	memset(text, 'f', sizeof(text));
+
+	lineLen = 0;
+	CHECK_EQ(uart_tx_write(text, sizeof(text)), UART_TX_LEN);
+	CHECK_EQ(uart_tx_write(text, 1), 0);
+	mock_irq_run();
+	// a run is at most half the ring, even with the whole ring queued
+	uint32_t const run = DMA1_Channel4->CNDTR;
+	CHECK(run <= UART_TX_LEN / 2);
+	for (uint32_t i = 0; i < run - 1; ++i) {
+		line_step();
+	}
+	CHECK_EQ(uart_tx_write(text, 1), 0);
+	line_step();
+	CHECK_EQ(uart_tx_write(text, sizeof(text)), run);
+	line_drain();
+	CHECK_EQ(lineLen, UART_TX_LEN + run);
+}
+
+/** Sending more than the ring holds waits for room, and the line never goes idle while there's text. */
+static void test_send_bulk(void)
+{
+	static char text[MAX_TEXT];
+	for (uint32_t i = 0; i < sizeof(text); ++i) {
+		text[i] = (char)(i * 7 + (i >> 8));
+	}
+	metrics_reset();
+	lineLen = 0;
+	waits = 0;
+	idleSteps = 0;
+
+	uart_tx_send(text, sizeof(text));
+	line_drain();
+	CHECK_EQ(lineLen, sizeof(text));
+	CHECK(memcmp(line, text, sizeof(text)) == 0);
+	CHECK_EQ(idleSteps, 0);
+
+	// each wait lasts until half the ring is free
+	uint32_t const expected = (sizeof(text) - UART_TX_LEN + UART_TX_LEN / 2 - 1) / (UART_TX_LEN / 2);
+	CHECK_EQ(waits, expected);
+	uint32_t stalls;
+	uint32_t max;
+	metrics_read(METRIC_UART_TX_STALLS, &stalls, &max);
+	CHECK_EQ(stalls, waits);
+	printf("%u characters sent through a %u character ring, %u waits for room, %u idle character times\n",
+		(unsigned)sizeof(text), UART_TX_LEN, waits, idleSteps);
+}
+
+/** A flush sleeps until the last run is complete, however much was queued, and doesn't sleep when nothing is. */
+static void test_flush(void)
+{
+	static char text[UART_TX_LEN * 3];
+	memset(text, 'z', sizeof(text));
+
+	lineLen = 0;
+	waits = 0;
+	uart_tx_flush();
+	CHECK_EQ(waits, 0);
+
+	// the wait fails the test if the line runs dry without waking it
+	uart_tx_write(text, 40);
+	uart_tx_flush();
+	CHECK_EQ(waits, 1);
+	CHECK_EQ(lineLen, 40);
+	CHECK_EQ(DMA1_Channel4->CCR, 0);
+
+	lineLen = 0;
+	uart_tx_send(text, sizeof(text));
+	uart_tx_flush();
+	CHECK_EQ(lineLen, sizeof(text));
+	CHECK_EQ(DMA1_Channel4->CCR, 0);
+	CHECK_EQ(line_drain(), 0);
+}
+
+int main(void)
+{
+	test_init();
+	test_single_run();
+	test_write_while_busy();
+	test_wrap();
+	test_full();
+	test_send_bulk();
+	test_flush();
+	return test_result("uart_tx");
+}
@@ -0,0 +1,196 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Tests the DMA output engine against the simulated TIM2 and DMA1 channel 2:
+ * the samples reaching the waveform port, and the timer clocks between them.
+ */
+
+#include "mock.h"
+#include "test.h"
+#include "wave_out.h"
+
+// state published for the engine, the test waveform doesn't need any
+static snapshot_t stateSnap;
+static snapshot_t otherSnap;
+
+/** Renders sample i as its index plus a marker, so the order the port sees them in can be checked. */
+static void render_index(void const *state, uint16_t *buf, uint16_t len, uint16_t periods)
+{
+	for (uint16_t i = 0; i < len; ++i) {
+		buf[i] = 0x8000 | i;
+	}
+}
+
+// next sample of the streamed test waveform
+static uint16_t runNext = 0;
+
+/** Streams a counter, so a lost or repeated sample shows. */
+static void run_count(void const *state, uint16_t *buf, uint16_t len)
+{
+	for (uint16_t i = 0; i < len; ++i) {
+		buf[i] = runNext++;
+	}
+}
+
+/** Sets up the engine from reset with nothing playing. */
+static void setup(void)
+{
+	mock_reset();
+	wave_out_init();
+	uint32_t const zero = 0;
+	snapshot_publish(&stateSnap, &zero, sizeof(zero));
+	snapshot_publish(&otherSnap, &zero, sizeof(zero));
+}
+
+static void test_init(void)
+{
+	setup();
+	CHECK(RCC->AHBENR & RCC_AHBENR_DMA1EN);
+	CHECK(RCC->APB1ENR & RCC_APB1ENR_TIM2EN);
+	CHECK(TIM2->DIER & TIM_DIER_UDE);
+	CHECK_EQ(DMA1_Channel2->CPAR, (uint32_t)&GPIOB->ODR);
+	CHECK(DMA1_Channel2->CMAR != 0);
+	// the refill can't be held off by anything
+	CHECK_EQ(NVIC->IP[DMA1_Channel2_IRQn], 0);
+	CHECK(NVIC->ISER[0] & (1UL << DMA1_Channel2_IRQn));
+}
+
+/**
+ * Plays freqMhz at up to rateHz from a table, and follows the samples to the port
+ * for two loops of the table, checking their order and the time between them.
+ */
+static void check_table(uint32_t freqMhz, uint32_t rateHz)
+{
+	setup();
+	wave_out_play(render_index, run_count, &stateSnap, freqMhz, rateHz);
+
+	wave_out_status_t status;
+	wave_out_get_status(&status);
+	CHECK_EQ(status.mode, WAVE_OUT_TABLE);
+	CHECK(status.len > 0 && status.len <= WAVE_OUT_BUF_LEN);
+	CHECK(status.rateHz <= rateHz);
+	// looping without interrupts
+	CHECK(!(DMA1_Channel2->CCR & (DMA_CCR1_HTIE | DMA_CCR1_TCIE)));
+	CHECK(DMA1_Channel2->CCR & DMA_CCR1_CIRC);
+
+	// the update that loads the rate outputs the first sample
+	mock_tim_step(2);
+	CHECK_EQ(GPIOB->ODR, 0x8000);
+
+	uint32_t const sampleTicks = TIM_CLK_HZ / status.rateHz;
+	uint64_t const start = mock_clock;
+	for (uint32_t i = 1; i <= 2 * status.len; ++i) {
+		uint32_t const ticks = mock_tim_until_update(2);
+		if (ticks != sampleTicks) {
+			CHECK_EQ(ticks, sampleTicks);
+			break;
+		}
+		if (GPIOB->ODR != (0x8000 | (i % status.len))) {
+			CHECK_EQ(GPIOB->ODR, 0x8000 | (i % status.len));
+			break;
+		}
+	}
+	CHECK_EQ(mock_dma_moved(2), 2 * status.len + 1);
+
+	// the table loops exactly: its periods take a whole number of timer clocks at the frequency
+	uint64_t const loopTicks = (mock_clock - start) / 2;
+	CHECK_EQ(loopTicks * freqMhz, (uint64_t)status.periods * TIM_CLK_HZ * 1000);
+}
+
+static void test_table(void)
+{
+	// 1 kHz at 100 kSPS is one period of 100 samples
+	check_table(1000000, 100000);
+	wave_out_status_t status;
+	wave_out_get_status(&status);
+	CHECK_EQ(status.len, 100);
+	CHECK_EQ(status.periods, 1);
+	CHECK_EQ(TIM2->PSC, 0);
+	CHECK_EQ(TIM2->ARR, 719);
+
+	// 440 Hz at 48 kSPS loops 11 periods in 1000 samples
+	check_table(440000, 48000);
+	wave_out_get_status(&status);
+	CHECK_EQ(status.len, 1000);
+	CHECK_EQ(status.periods, 11);
+
+	// frequencies that take many periods, or a full buffer, to loop in whole timer clocks
+	check_table(1234000, 500000);
+	check_table(700000, 500000);
+	check_table(1500, 10000);
+}
+
+/** Streams the counter at rateHz, checking every sample reaches the port on time. */
+static void check_stream(uint32_t rateHz)
+{
+	// a frequency that can't loop from the buffer streams instead
+	setup();
+	runNext = 0;
+	wave_out_play(render_index, run_count, &stateSnap, 1234567, rateHz);
+	wave_out_status_t status;
+	wave_out_get_status(&status);
+	CHECK_EQ(status.mode, WAVE_OUT_STREAM);
+	CHECK_EQ(status.len, 2 * WAVE_OUT_STREAM_HALF_LEN);
+	CHECK_EQ(status.rateHz, rateHz);
+	CHECK((DMA1_Channel2->CCR & (DMA_CCR1_HTIE | DMA_CCR1_TCIE)) == (DMA_CCR1_HTIE | DMA_CCR1_TCIE));
+
+	// with the refill served as soon as it's requested, the port sees the counter without a gap
+	mock_tim_step(2);
+	CHECK_EQ(GPIOB->ODR, 0);
+	for (uint32_t i = 1; i < 10 * WAVE_OUT_STREAM_HALF_LEN; ++i) {
+		uint32_t const ticks = mock_tim_until_update(2);
+		mock_irq_run();
+		if (ticks != TIM_CLK_HZ / rateHz || GPIOB->ODR != i) {
+			CHECK_EQ(ticks, TIM_CLK_HZ / rateHz);
+			CHECK_EQ(GPIOB->ODR, i);
+			break;
+		}
+	}
+}
+
+static void test_stream(void)
+{
+	check_stream(100000);
+	check_stream(WAVE_OUT_MAX_RATE_HZ);
+	// the slowest rate counts more timer clocks than ARR holds
+	check_stream(WAVE_OUT_MIN_RATE_HZ);
+	CHECK(TIM2->PSC > 0);
+}
+
+static void test_stop(void)
+{
+	setup();
+	wave_out_play(render_index, run_count, &stateSnap, 1000000, 100000);
+
+	// only the waveform playing can stop the output
+	CHECK(!wave_out_stop(&otherSnap));
+	CHECK(TIM2->CR1 & TIM_CR1_CEN);
+	CHECK(DMA1_Channel2->CCR & DMA_CCR1_EN);
+
+	CHECK(wave_out_stop(&stateSnap));
+	CHECK(!(TIM2->CR1 & TIM_CR1_CEN));
+	CHECK(!(DMA1_Channel2->CCR & DMA_CCR1_EN));
+	wave_out_status_t status;
+	wave_out_get_status(&status);
+	CHECK_EQ(status.mode, WAVE_OUT_STOPPED);
+
+	// nothing reaches the port once stopped
+	GPIOB->ODR = 0x1234;
+	for (int i = 0; i < 1000; ++i) {
+		mock_tim_step(2);
+	}
+	CHECK_EQ(GPIOB->ODR, 0x1234);
+	CHECK(!wave_out_stop(&stateSnap));
+}
+
+int main(void)
+{
+	test_init();
+	test_table();
+	test_stream();
+	test_stop();
+	return test_result("wave_out");
+}
@@ -0,0 +1,93 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "tickless.h"
+#include "global.h"
+#include "cpu_load.h"
+
+// TIM4 times the sleep
+#define WAKE_TIM		TIM4
+#define WAKE_TIM_IRQn	TIM4_IRQn
+
+// TIM4 counts at 10 kHz, so a 16-bit sleep lasts up to 6.5 s
+#define WAKE_COUNT_HZ	10000
+#define COUNTS_PER_TICK	(WAKE_COUNT_HZ / (1000000 / TICKLESS_TICK_US))
+// longest sleep, short of a full lap of the counter so the time slept can't wrap
+// before it's read back after the wakeup
+#define MAX_SLEEP_COUNTS	(0xFFFF - 16 * COUNTS_PER_TICK)
+
+// counts slept that didn't add up to a whole tick, carried to the next sleep
+static uint32_t leftoverCounts = 0;
+
+void tickless_init(void)
+{
+	RCC->APB1ENR |= RCC_APB1ENR_TIM4EN;
+
+	// count freely over the full 16 bits, a sleep ends on a channel 1 compare match
+	// the counter and its prescaler are never reset, so the part of a count that's
+	// under way when a sleep ends isn't lost, it's counted by the next one
+	WAKE_TIM->CR1 = TIM_CR1_URS;
+	WAKE_TIM->PSC = TIM_CLK_HZ / WAKE_COUNT_HZ - 1;
+	WAKE_TIM->ARR = 0xFFFF;
+	WAKE_TIM->DIER = 0;
+	// load the prescaler once
+	WAKE_TIM->EGR = TIM_EGR_UG;
+	WAKE_TIM->SR = 0;
+	WAKE_TIM->CR1 |= TIM_CR1_CEN;
+
+	// the interrupt only has to wake the CPU, so it runs below everything else
+	NVIC->ICPR[WAKE_TIM_IRQn/32] = 1UL << (WAKE_TIM_IRQn%32);	// clear any previous pending interrupt flag
+	NVIC->IP[WAKE_TIM_IRQn] = 0xC0;		// set priority to 0xC0
+	NVIC->ISER[WAKE_TIM_IRQn/32] = 1UL << (WAKE_TIM_IRQn%32);	// set interrupt enable bit
+}
+
+uint32_t tickless_sleep(uint32_t ticks)
+{
+	// a timeout is already due, don't sleep through it
+	if (ticks == 0) {
+		return 0;
+	}
+
+	uint32_t counts = MAX_SLEEP_COUNTS;
+	if (ticks < MAX_SLEEP_COUNTS / COUNTS_PER_TICK) {
+		counts = ticks * COUNTS_PER_TICK;
+	}
+	// the leftover is already slept, so wake that much sooner
+	counts -= (leftoverCounts < counts) ? leftoverCounts : 0;
+	// a compare set to the count under way could be passed before it's written and wait a whole lap
+	if (counts < 2) {
+		counts = 2;
+	}
+
+	// arm the compare with interrupts held off, so nothing delays it past the count it's set for
+	__disable_irq();
+	uint16_t const start = WAKE_TIM->CNT;
+	WAKE_TIM->CCR1 = start + counts;
+	WAKE_TIM->SR = ~TIM_SR_CC1IF;
+	WAKE_TIM->DIER = TIM_DIER_CC1IE;
+	__enable_irq();
+
+	cpu_load_idle();
+
+	// woken by the compare or by any other interrupt, either way the counter kept running
+	WAKE_TIM->DIER = 0;
+	uint16_t const slept = WAKE_TIM->CNT - start;
+
+	leftoverCounts += slept;
+	uint32_t const sleptTicks = leftoverCounts / COUNTS_PER_TICK;
+	leftoverCounts -= sleptTicks * COUNTS_PER_TICK;
+	return sleptTicks;
+}
+
+/*-----------------------------------------------------------------------------
+	TIM4 IRQ Handler
+		Sleep ran out, waking the CPU is all it has to do
+ *---------------------------------------------------------------------------*/
+void TIM4_IRQHandler(void)
+{
+	WAKE_TIM->SR = 0;
+}
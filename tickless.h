@@ -0,0 +1,32 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Tickless idle for the RTX idle demon.
+ * The idle demon suspends the RTX scheduler, which masks the SysTick and returns how
+ * many ticks it can sleep before the next timeout. TIM4 is set to wake the CPU then,
+ * and any other interrupt, like a received character, wakes it sooner.
+ * TIM4 runs freely and the time slept is the difference between its counts before
+ * and after, handed back to RTX so its timekeeping stays correct.
+ * While all the threads wait forever on their queues, the CPU only wakes when TIM4
+ * runs out, about every 6.5 s, instead of 1000 times a second.
+ * With OS_TIMERS set in RTX_Conf_CM.c the idle demon leaves the tick running and
+ * only sleeps until the next interrupt.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/** Length of an RTX tick, RTX_Conf_CM.c stops the build if OS_TICK differs. */
+#define TICKLESS_TICK_US	1000
+
+/** Initialize the TIM4 wakeup timer. */
+void tickless_init(void);
+/**
+ * Sleeps for up to ticks RTX ticks, or until an interrupt wakes the CPU.
+ * Returns the number of whole ticks slept, for os_resume.
+ */
+uint32_t tickless_sleep(uint32_t ticks);
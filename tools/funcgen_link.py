@@ -0,0 +1,263 @@
+#!/usr/bin/env python3
+#
+# CE 426 - Real-Time Embedded Systems
+# Instructor: Dr. Tewolde
+# Author: Benjamin Hall
+# Final Project: Function Generator
+#
+# Drives the generator over the binary command link (cmd_link.h) instead of the menus.
+# Can be imported by test scripts, or run to send one command. The link is opened by the first
+# frame and closed again before exiting, so the menus keep working in between.
+# A trace is printed in the same format as the menu dump, so it can be piped into trace_decode.py.
+#
+# Usage: funcgen_link.py PORT ping
+#        funcgen_link.py PORT get WAVE
+#        funcgen_link.py PORT set WAVE amplitude=50 freq=1000.5 duty=25 rate=10000
+#        funcgen_link.py PORT enable WAVE on|off
+#        funcgen_link.py PORT stats
+#        funcgen_link.py PORT trace
+
+import os
+import select
+import struct
+import sys
+import termios
+import time
+
+# opcodes and statuses, in sync with cmd_link.h
+OP_PING = 0x01
+OP_CLOSE = 0x02
+OP_SET = 0x10
+OP_GET = 0x11
+OP_ENABLE = 0x12
+OP_STATS = 0x20
+OP_TRACE = 0x21
+REPLY = 0x80
+MAX_FRAME = 256
+
+STATUSES = ['ok', 'unknown opcode', 'bad length', 'bad argument', 'busy']
+
+# waveform_id_t in waveform.h and waveform_cfg_param_t in waveform_cfg.h
+WAVEFORMS = ['pwm', 'sawtooth', 'sine', 'triangle']
+PARAMS = {'amplitude': 0, 'freq': 1, 'duty': 2, 'rate': 3}
+
+# names of the metrics, in the order of metric_t in metrics.h
+METRICS = [
+	'uart rx depth',
+	'uart rx drops',
+	'uart overruns',
+	'uart tx stalls',
+	'uart tx stall us',
+	'cfg mailbox depth',
+	'cfg mailbox drops',
+	'cfg applied',
+	'stream refills',
+	'samples generated',
+	'link commands',
+	'link bad frames',
+]
+
+
+class LinkError(Exception):
+	pass
+
+
+def crc32(data):
+	"""CRC of the STM32 CRC unit, fed little-endian words padded with zeros."""
+	crc = 0xFFFFFFFF
+	data = bytes(data) + bytes(-len(data) % 4)
+	for i in range(0, len(data), 4):
+		crc ^= struct.unpack_from('<I', data, i)[0]
+		for _ in range(32):
+			crc = ((crc << 1) ^ 0x04C11DB7 if crc & 0x80000000 else crc << 1) & 0xFFFFFFFF
+	return crc
+
+
+def cobs_encode(data):
+	out = bytearray([0])
+	code = 0
+	for byte in data:
+		if byte == 0:
+			out[code] = len(out) - code
+			code = len(out)
+			out.append(0)
+			continue
+		out.append(byte)
+		if len(out) - code == 0xFF:
+			out[code] = 0xFF
+			code = len(out)
+			out.append(0)
+	out[code] = len(out) - code
+	return bytes(out)
+
+
+def cobs_decode(data):
+	"""Returns the decoded bytes, or None if the encoding is invalid."""
+	out = bytearray()
+	i = 0
+	while i < len(data):
+		code = data[i]
+		i += 1
+		if code == 0 or i + code - 1 > len(data):
+			return None
+		out += data[i:i + code - 1]
+		i += code - 1
+		if code != 0xFF and i < len(data):
+			out.append(0)
+	return bytes(out)
+
+
+class Link:
+	"""One end of the binary command link, over a serial port or a pseudo-terminal."""
+
+	def __init__(self, port, baud=115200, timeout=0.5, retries=3):
+		self.fd = os.open(port, os.O_RDWR | os.O_NOCTTY)
+		self.timeout = timeout
+		self.retries = retries
+		self.seq = 0
+		self.rx = bytearray()
+		# raw 8N1, nothing translated or echoed
+		attrs = termios.tcgetattr(self.fd)
+		speed = getattr(termios, 'B%d' % baud)
+		attrs[0] = 0
+		attrs[1] = 0
+		attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+		attrs[3] = 0
+		attrs[4] = attrs[5] = speed
+		attrs[6][termios.VMIN] = 0
+		attrs[6][termios.VTIME] = 0
+		termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+
+	def close(self):
+		"""Returns the generator to the menus and closes the port."""
+		try:
+			self.command(OP_CLOSE)
+		finally:
+			os.close(self.fd)
+
+	def _read_frame(self, deadline):
+		"""Returns the next frame that decodes with a good CRC, or None at the deadline."""
+		while True:
+			while 0 in self.rx:
+				end = self.rx.index(0)
+				frame = cobs_decode(bytes(self.rx[:end]))
+				del self.rx[:end + 1]
+				# menu text and empty frames don't decode to anything with a good CRC
+				if frame and len(frame) >= 7 and crc32(frame[:-4]) == struct.unpack('<I', frame[-4:])[0]:
+					return frame[:-4]
+			left = deadline - time.monotonic()
+			if left <= 0 or not select.select([self.fd], [], [], left)[0]:
+				return None
+			self.rx += os.read(self.fd, 4096)
+
+	def command(self, op, payload=b''):
+		"""Sends a command until its reply comes back, returns the reply payload after the status."""
+		self.seq = (self.seq + 1) & 0xFF
+		body = bytes([self.seq, op]) + bytes(payload)
+		if len(body) + 4 > MAX_FRAME:
+			raise LinkError('command too long')
+		# a delimiter first opens the link from a menu, and is an empty frame once it's open
+		frame = b'\0' + cobs_encode(body + struct.pack('<I', crc32(body))) + b'\0'
+		for _ in range(self.retries + 1):
+			os.write(self.fd, frame)
+			deadline = time.monotonic() + self.timeout
+			while True:
+				reply = self._read_frame(deadline)
+				if reply is None:
+					# lost on the way there or back, the same sequence number gets the reply again
+					break
+				if reply[0] == self.seq and reply[1] == op | REPLY:
+					status = reply[2]
+					if status != 0:
+						name = STATUSES[status] if status < len(STATUSES) else 'status %d' % status
+						raise LinkError('op 0x%02x: %s' % (op, name))
+					return reply[3:]
+		raise LinkError('op 0x%02x: no reply' % op)
+
+	def ping(self):
+		"""Returns (version, clock Hz)."""
+		return struct.unpack('<BI', self.command(OP_PING))
+
+	def set(self, wave, **params):
+		"""Applies params together, in the units of the menus: amplitude %, freq mHz, duty %, rate SPS."""
+		payload = bytes([wave])
+		for name, value in params.items():
+			payload += struct.pack('<BI', PARAMS[name], value)
+		self.command(OP_SET, payload)
+
+	def get(self, wave):
+		freqMhz, rate, amplitude, duty, enabled = struct.unpack('<IIBBB', self.command(OP_GET, bytes([wave])))
+		return {'freq': freqMhz, 'rate': rate, 'amplitude': amplitude, 'duty': duty, 'enabled': bool(enabled)}
+
+	def enable(self, wave, on=True):
+		self.command(OP_ENABLE, bytes([wave, 1 if on else 0]))
+
+	def stats(self):
+		"""Returns {name: (value, max)}."""
+		reply = self.command(OP_STATS)
+		stats = {}
+		for i in range(reply[0]):
+			name = METRICS[i] if i < len(METRICS) else 'metric %d' % i
+			stats[name] = struct.unpack_from('<II', reply, 1 + 8 * i)
+		return stats
+
+	def trace(self):
+		"""Returns the trace records as (time, event, arg, data), then clears the trace."""
+		records = []
+		while True:
+			reply = self.command(OP_TRACE, struct.pack('<H', len(records)))
+			count, first = struct.unpack_from('<HH', reply)
+			records += [struct.unpack_from('<IBBH', reply, i) for i in range(4, len(reply), 8)]
+			if len(records) >= count:
+				return records
+
+
+def wave_id(name):
+	if name not in WAVEFORMS:
+		sys.exit('unknown waveform %s, one of %s' % (name, ', '.join(WAVEFORMS)))
+	return WAVEFORMS.index(name)
+
+
+def main():
+	if len(sys.argv) < 3:
+		sys.exit('usage: funcgen_link.py PORT ping|get|set|enable|stats|trace [ARGS]')
+	link = Link(sys.argv[1])
+	cmd = sys.argv[2]
+	args = sys.argv[3:]
+	try:
+		if cmd == 'ping':
+			version, clockHz = link.ping()
+			print('version %d, clock %d Hz' % (version, clockHz))
+		elif cmd == 'get':
+			status = link.get(wave_id(args[0]))
+			print('amplitude %d%%, freq %.3f Hz, duty %d%%, rate %d SPS, %s' % (status['amplitude'],
+				status['freq'] / 1000, status['duty'], status['rate'], 'enabled' if status['enabled'] else 'disabled'))
+		elif cmd == 'set':
+			params = {}
+			for arg in args[1:]:
+				name, _, value = arg.partition('=')
+				# frequency is given in Hz and sent in mHz
+				params[name] = round(float(value) * 1000) if name == 'freq' else int(value)
+			link.set(wave_id(args[0]), **params)
+		elif cmd == 'enable':
+			link.enable(wave_id(args[0]), args[1] == 'on')
+		elif cmd == 'stats':
+			for name, (value, peak) in link.stats().items():
+				print('%s: %d (%d)' % (name, value, peak))
+		elif cmd == 'trace':
+			_, clockHz = link.ping()
+			records = link.trace()
+			print('TRACE BEGIN %d %d' % (clockHz, len(records)))
+			for record in records:
+				print('%08x %02x %02x %04x' % record)
+			print('TRACE END')
+		else:
+			sys.exit('unknown command %s' % cmd)
+	except LinkError as e:
+		sys.exit(str(e))
+	finally:
+		link.close()
+
+
+if __name__ == '__main__':
+	main()
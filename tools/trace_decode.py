@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+#
+# CE 426 - Real-Time Embedded Systems
+# Instructor: Dr. Tewolde
+# Author: Benjamin Hall
+# Final Project: Function Generator
+#
+# Decodes an event trace dumped over the UART ("[8] Dump Event Trace") into a timeline.
+# Pass a terminal capture, or pipe it in; everything outside TRACE BEGIN / TRACE END is ignored.
+# Each line shows the time since the first record, the time since the previous record and the event.
+# A summary of the config latency and the refill interrupt time follows the timeline.
+#
+# Usage: trace_decode.py [capture.log]
+
+import sys
+
+# names of the events, in the order of trace_event_t in trace.h
+EVENTS = [
+	'cfg send',
+	'cfg put',
+	'cfg get',
+	'cfg done',
+	'refill enter',
+	'refill exit',
+	'out table',
+	'out stream',
+	'out pwm',
+	'out stop',
+	'uart rx',
+	'link cmd',
+]
+
+WAVEFORMS = ['pwm', 'sawtooth', 'sine', 'triangle']
+PARAMS = ['amplitude', 'freq', 'duty', 'rate', 'enable']
+
+
+def wave_name(arg):
+	return WAVEFORMS[arg] if arg < len(WAVEFORMS) else 'wave %d' % arg
+
+
+def param_names(mask):
+	return ','.join(name for i, name in enumerate(PARAMS) if mask & (1 << i)) or '-'
+
+
+def describe(event, arg, data):
+	"""Turns the arguments of a record into text."""
+	name = EVENTS[event] if event < len(EVENTS) else 'event %d' % event
+	if name in ('cfg send', 'cfg put', 'cfg get'):
+		return '%s %s [%s]' % (name, wave_name(arg), param_names(data))
+	if name == 'cfg done':
+		return '%s %s' % (name, wave_name(arg))
+	if name == 'refill enter':
+		return '%s half %d' % (name, arg)
+	if name == 'refill exit':
+		return '%s first sample 0x%04x%s' % (name, data, ' STALE' if arg else '')
+	if name == 'out table':
+		return '%s %d samples, %d periods' % (name, data, arg)
+	if name == 'out stream':
+		return '%s %d samples' % (name, data)
+	if name == 'out pwm':
+		return '%s %s reload %d' % (name, 'update' if arg else 'start', data)
+	if name == 'out stop':
+		return '%s %s' % (name, 'pwm' if arg else 'dma')
+	if name == 'uart rx':
+		return '%s %d chars, last %r' % (name, data, chr(arg))
+	if name == 'link cmd':
+		return '%s op 0x%02x seq %d' % (name, arg, data)
+	return '%s arg %d data %d' % (name, arg, data)
+
+
+def read_dumps(lines):
+	"""Yields (clock Hz, records) for each dump, a record is (time, event, arg, data)."""
+	clockHz = None
+	records = None
+	for line in lines:
+		words = line.split()
+		if len(words) == 4 and words[:2] == ['TRACE', 'BEGIN']:
+			clockHz = int(words[2])
+			records = []
+		elif words == ['TRACE', 'END'] and records is not None:
+			yield clockHz, records
+			records = None
+		elif records is not None and len(words) == 4:
+			try:
+				records.append(tuple(int(w, 16) for w in words))
+			except ValueError:
+				# line noise in the capture
+				pass
+
+
+def print_stats(name, times):
+	if times:
+		print('  %-24s n=%-5d min %9.2f  mean %9.2f  max %9.2f us'
+			% (name, len(times), min(times), sum(times) / len(times), max(times)))
+
+
+def decode(clockHz, records):
+	# the clock is 32 bits, unwrap it so the timeline keeps counting up
+	us = []
+	base = 0
+	for i, (time, _, _, _) in enumerate(records):
+		if i and time < records[i - 1][0]:
+			base += 1 << 32
+		us.append((base + time) * 1e6 / clockHz)
+
+	print('%d records, clock %d Hz' % (len(records), clockHz))
+	if not records:
+		return
+	print('%12s %10s  event' % ('time us', 'delta us'))
+	for i, (_, event, arg, data) in enumerate(records):
+		delta = us[i] - us[i - 1] if i else 0.0
+		print('%12.2f %10.2f  %s' % (us[i] - us[0], delta, describe(event, arg, data)))
+
+	# pair up the events that bracket each interval
+	mailWait = []
+	cfgLatency = []
+	refill = []
+	refillPeriod = []
+	send = {}
+	put = {}
+	lastEnter = None
+	for i, (_, event, arg, _) in enumerate(records):
+		name = EVENTS[event] if event < len(EVENTS) else None
+		if name == 'cfg send':
+			send[arg] = us[i]
+		elif name == 'cfg put' and arg in send:
+			mailWait.append(us[i] - send[arg])
+			put[arg] = send.pop(arg)
+		elif name == 'cfg done' and arg in put:
+			cfgLatency.append(us[i] - put.pop(arg))
+		elif name == 'refill enter':
+			if lastEnter is not None:
+				refillPeriod.append(us[i] - lastEnter)
+			lastEnter = us[i]
+		elif name == 'refill exit' and lastEnter is not None:
+			refill.append(us[i] - lastEnter)
+
+	print()
+	print('summary:')
+	print_stats('mailbox wait', mailWait)
+	print_stats('send to applied', cfgLatency)
+	print_stats('refill irq', refill)
+	print_stats('refill period', refillPeriod)
+	stale = sum(1 for r in records if r[1] < len(EVENTS) and EVENTS[r[1]] == 'refill exit' and r[2])
+	if stale:
+		print('  %d refills interrupted a config update and used the previous state' % stale)
+
+
+def main():
+	src = open(sys.argv[1], errors='replace') if len(sys.argv) > 1 else sys.stdin
+	found = False
+	for clockHz, records in read_dumps(src):
+		if found:
+			print()
+		decode(clockHz, records)
+		found = True
+	if not found:
+		sys.exit('no TRACE BEGIN / TRACE END dump found')
+
+
+if __name__ == '__main__':
+	main()
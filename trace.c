@@ -0,0 +1,61 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "trace.h"
+#include "profile.h"
+#include "stm32f10x.h"
+
+#if (TRACE_LEN & (TRACE_LEN - 1)) != 0
+#error "TRACE_LEN must be a power of 2"
+#endif
+
+// the last TRACE_LEN events, the write index wraps around it
+static trace_record_t records[TRACE_LEN];
+// total number of slots reserved, the next record goes in records[head % TRACE_LEN]
+static volatile uint32_t head = 0;
+// non-zero while the buffer is being read
+static volatile uint8_t bPaused = 0;
+
+void trace_event(trace_event_t event, uint8_t arg, uint16_t data)
+{
+	if (bPaused) {
+		return;
+	}
+
+	// reserve a slot, an interrupt that records in between makes the store fail and retry
+	uint32_t slot;
+	do {
+		slot = __LDREXW(&head);
+	} while (__STREXW(slot + 1, &head));
+
+	trace_record_t *record = &records[slot & (TRACE_LEN - 1)];
+	record->time = profile_now();
+	record->event = event;
+	record->arg = arg;
+	record->data = data;
+}
+
+uint16_t trace_pause(void)
+{
+	bPaused = 1;
+	// called from the lowest priority thread that records, so every writer that
+	// preempted it has finished its record
+	return (head < TRACE_LEN) ? head : TRACE_LEN;
+}
+
+void trace_read(uint16_t i, trace_record_t *record)
+{
+	// the oldest record is the next slot to be overwritten once the buffer has wrapped
+	uint32_t const first = (head < TRACE_LEN) ? 0 : head;
+	*record = records[(first + i) & (TRACE_LEN - 1)];
+}
+
+void trace_resume(void)
+{
+	head = 0;
+	bPaused = 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Binary event trace.
+ * Each event is an 8-byte record stamped with the profiler clock and kept in a
+ * RAM ring buffer, so the last TRACE_LEN events can be dumped over the UART
+ * after something goes wrong and turned into a timeline by tools/trace_decode.py.
+ *
+ * Events can be recorded from any thread or interrupt. A slot is reserved with an
+ * exclusive load/store on the write index, so recording never disables interrupts.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/** Number of records kept, a power of 2. */
+#ifndef TRACE_LEN
+#define TRACE_LEN	128
+#endif
+
+/** The traced events, keep tools/trace_decode.py in sync. */
+typedef enum _trace_event_t {
+	/** Config mail about to be allocated, arg is the waveform, data the param mask */
+	TRACE_CFG_SEND,
+	/** Config mail allocated and about to be put, the time since TRACE_CFG_SEND was spent waiting for a free slot */
+	TRACE_CFG_PUT,
+	/** Config mail taken by the waveform thread, arg is the waveform, data the param mask */
+	TRACE_CFG_GET,
+	/** Config applied and its status published, arg is the waveform */
+	TRACE_CFG_DONE,
+	/** Stream refill interrupt entered, arg is the half being refilled */
+	TRACE_REFILL_ENTER,
+	/** Stream refill finished, arg is non-zero if it interrupted a publish and used the state from before it, data the first new sample */
+	TRACE_REFILL_EXIT,
+	/** Output started looping a table, arg is the number of periods, data the number of samples */
+	TRACE_OUT_TABLE,
+	/** Output started streaming, data is the number of samples */
+	TRACE_OUT_STREAM,
+	/** PWM timing written, arg is non-zero for an update of a running PWM, data the reload value */
+	TRACE_OUT_PWM,
+	/** Output stopped, arg is non-zero for the PWM timer */
+	TRACE_OUT_STOP,
+	/** Characters received, arg is the last one, data the number since the last receive event */
+	TRACE_UART_RX,
+	/** Binary link command received, arg is the opcode, data the sequence number */
+	TRACE_LINK_CMD,
+
+	TRACE_NUM_EVENTS,
+} trace_event_t;
+
+/** One traced event. */
+typedef struct _trace_record_t {
+	/** Profiler clock when the event happened */
+	uint32_t time;
+	/** The event, a trace_event_t */
+	uint8_t event;
+	/** Small argument of the event */
+	uint8_t arg;
+	/** Larger argument of the event */
+	uint16_t data;
+} trace_record_t;
+
+/** Records an event, safe from any thread or interrupt. */
+void trace_event(trace_event_t event, uint8_t arg, uint16_t data);
+/**
+ * Stops recording so the buffer can be read without it changing,
+ * call it from the lowest priority thread that records events.
+ * Returns the number of records held, they're read oldest first with trace_read.
+ */
+uint16_t trace_pause(void);
+/** Reads the i'th oldest record while recording is paused. */
+void trace_read(uint16_t i, trace_record_t *record);
+/** Clears the buffer and starts recording again. */
+void trace_resume(void);
@@ -7,165 +7,181 @@
 
 #include "triangle_wave.h"
 #include "global.h"
+#include "dds.h"
+#include "snapshot.h"
 #include "utils.h"
+#include "wave_out.h"
 
 /** Stores the state of the triangle waveform. */
 typedef struct _triangle_state_t {
 	// configuration values
 	uint16_t amplitude;
-	uint16_t periodMs;
+	uint32_t freqMhz;
+	uint32_t sampleRateHz;
 	uint8_t bRunning;
 
 	// calculated values
-	uint16_t halfPeriodMs;
+	uint32_t tuningWord;
+	uint32_t ampScale;
 } triangle_state_t;
+// the state is published to the output stream refill
+SNAPSHOT_CHECK_SIZE(triangle_state_t);
+
+// state of the waveform, owned by the waveform manager thread
+static triangle_state_t curState = {
+	// initial state: 100% amplitude, 10 Hz, default sample rate, disabled
+	.amplitude = SCALE_AMPLITUDE(100),
+	.freqMhz = 10000,
+	.sampleRateHz = WAVE_OUT_DEFAULT_RATE_HZ,
+	.bRunning = 0,
+};
+
+static uint32_t phase = 0;
+
+// published copy of the state for the output stream refill
+static snapshot_t stateSnap;
+
+/** Calculates the triangle output sample at the given phase. */
+static inline uint16_t triangle_sample(triangle_state_t const *state, uint32_t curPhase);
+/** Runs the triangle waveform for the next len samples of the output stream. */
+static void triangle_run(void const *arg, uint16_t *buf, uint16_t len);
+
+/** Calculates and applies the DDS tuning word to the waveform. */
+static inline void apply_tuningWord(triangle_state_t *state)
+{
+	state->tuningWord = dds_tuning_word_mhz(state->freqMhz, state->sampleRateHz);
+}
 
-static uint16_t curTimeMs = 0;
-
-// mail queue of configuration parameters to apply
-static osMailQDef(triangle_cfg_q, 0x8, waveform_cfg_t);
-osMailQId Q_triangle_cfg_id;
-
-// message queue to send cfg param values from a recv request
-static osMessageQDef(triangle_cfg_recv_q, 0x8, uint32_t);
-osMessageQId Q_triangle_cfg_recv_id;
+/** Calculates and applies the amplitude scale factor to the waveform. */
+static inline void apply_ampScale(triangle_state_t *state)
+{
+	state->ampScale = dds_amplitude_scale(state->amplitude);
+}
 
-// mutex to protect the shared state of the waveform
-static osMutexDef(triangle_state_m);
-osMutexId M_triangle_state;
+/** Renders whole periods of the waveform into buf, for the output engine to loop. */
+static void render_periods(void const *arg, uint16_t *buf, uint16_t len, uint16_t periods)
+{
+	triangle_state_t const *state = arg;
 
-/** Runs the triangle waveform assuming the use of a 1ms timer. */
-static void triangle_run(void const *arg);
-// 1ms timer for the waveform
-static osTimerDef(triangle_run_timer, triangle_run);
-static osTimerId TMR_triangle_run_timer;
+	uint32_t const tuningWord = dds_tuning_word_len(len, periods);
+	uint32_t renderPhase = 0;
+	for (uint16_t i = 0; i < len; ++i) {
+		buf[i] = triangle_sample(state, dds_next(&renderPhase, tuningWord));
+	}
+}
 
-void triangle_wave_init(void)
+/** Starts or updates the output of the waveform. */
+static void start_output(triangle_state_t const *state)
 {
-	// create the mailbox, message queue, and mutex
-	Q_triangle_cfg_id = osMailCreate(osMailQ(triangle_cfg_q), NULL);
-	Q_triangle_cfg_recv_id = osMessageCreate(osMessageQ(triangle_cfg_recv_q), NULL);
-	M_triangle_state = osMutexCreate(osMutex(triangle_state_m));
+	// publish the state, a stream in progress picks it up at its next half buffer
+	snapshot_publish(&stateSnap, state, sizeof(*state));
+	// loop whole periods if they fit in the output buffer at the sample rate, otherwise generate them live
+	wave_out_play(render_periods, triangle_run, &stateSnap, state->freqMhz, state->sampleRateHz);
 }
 
-/** Sends the requested config parameter to the message queue. */
-static void send_cfg_param(triangle_state_t *state, waveform_cfg_param_t param)
+/** Reads a config parameter in the units it was sent in. */
+static uint32_t triangle_get(waveform_cfg_param_t param)
 {
 	uint32_t value = 0;
 	switch (param) {
 		case PARAM_AMPLITUDE:
-			value = AMPLITUDE_TO_USER(state->amplitude);
+			value = AMPLITUDE_TO_USER(curState.amplitude);
 			break;
-		case PARAM_PERIOD_MS:
-			value = state->periodMs;
+		case PARAM_FREQ_MHZ:
+			value = curState.freqMhz;
+			break;
+		case PARAM_SAMPLE_RATE:
+			value = curState.sampleRateHz;
 			break;
 		case PARAM_ENABLE:
-			value = state->bRunning;
+			value = curState.bRunning;
 			break;
 		default:
 			break;
 	}
-	osMessagePut(Q_triangle_cfg_recv_id, value, 0);
+	return value;
 }
 
-/** Calculates and applies the half-period to the waveform. */
-static inline void apply_halfPeriod(triangle_state_t *state)
+/** Calculates the values that depend on the initial config. */
+static void triangle_init(void)
 {
-	state->halfPeriodMs = state->periodMs >> 1;
+	apply_tuningWord(&curState);
+	apply_ampScale(&curState);
 }
 
-void triangle_wave_thread(void const *arg)
+/** Applies a batch of config parameters, updating the output once if it's running. */
+static void triangle_set(waveform_batch_t const *batch)
 {
-	// initial state: 100% amplitude, 100ms period, disabled
-	triangle_state_t state = {
-		.amplitude = SCALE_AMPLITUDE(100),
-		.periodMs = 100,
-		.bRunning = 0,
-	};
-	apply_halfPeriod(&state);
-
-	// create the timer using state as the input param
-	TMR_triangle_run_timer = osTimerCreate(osTimer(triangle_run_timer), osTimerPeriodic, &state);
-
-	osEvent retval;
-	while (1) {
-		// wait for a new config param
-		retval = osMailGet(Q_triangle_cfg_id, osWaitForever);
-		if (retval.status == osEventMail) {
-			waveform_cfg_t *cfg = retval.value.p;
-
-			// lock access to the shared state
-			osMutexWait(M_triangle_state, osWaitForever);
-			switch (cfg->type) {
-				case PARAM_AMPLITUDE:
-				{
-					state.amplitude = SCALE_AMPLITUDE(cfg->value);
-					break;
-				}
-				case PARAM_PERIOD_MS:
-				{
-					state.periodMs = cfg->value;
-					apply_halfPeriod(&state);
-					break;
-				}
-				case PARAM_ENABLE:
-				{
-					if (cfg->value) {
-						// toggle enable if value is non-zero
-						state.bRunning = !state.bRunning;
-					} else {
-						// otherwise disable output
-						state.bRunning = 0;
-					}
-
-					if (state.bRunning) {
-						// we are now enabled, start the timer
-						osTimerStart(TMR_triangle_run_timer, 1);
-					} else {
-						// we are now disabled, stop the timer
-						osTimerStop(TMR_triangle_run_timer);
-						// set output to 0 and reset time
-						GPIO_Write(WAVEFORM_PORT, 0);
-						curTimeMs = 0;
-					}
-					break;
-				}
-				case PARAM_RECV:
-				{
-					send_cfg_param(&state, cfg->value);
-					break;
-				}
-				default:
-					break;
-			}
-			osMutexRelease(M_triangle_state);
-
-			osMailFree(Q_triangle_cfg_id, cfg);
+	uint32_t value;
+	// non-zero if the running output has to pick up the new config
+	uint8_t bChanged = 0;
+
+	if (waveform_batch_get(batch, PARAM_AMPLITUDE, &value)) {
+		curState.amplitude = SCALE_AMPLITUDE(value);
+		apply_ampScale(&curState);
+		bChanged = 1;
+	}
+	if (waveform_batch_get(batch, PARAM_FREQ_MHZ, &value)) {
+		curState.freqMhz = value;
+		bChanged = 1;
+	}
+	if (waveform_batch_get(batch, PARAM_SAMPLE_RATE, &value)) {
+		// ignore rates the output engine can't time
+		if (value >= WAVE_OUT_MIN_RATE_HZ && value <= WAVE_OUT_MAX_RATE_HZ) {
+			curState.sampleRateHz = value;
+			bChanged = 1;
 		}
 	}
-}
+	if (bChanged) {
+		apply_tuningWord(&curState);
+	}
 
-static void triangle_run(void const *arg)
-{
-	// lock access to shared state
-	osMutexWait(M_triangle_state, osWaitForever);
-	{
-		triangle_state_t const *state = arg;
-
-		// if period has elapsed, wrap back around to 0
-		if (curTimeMs >= state->periodMs) {
-			curTimeMs = 0;
+	if (waveform_batch_get(batch, PARAM_ENABLE, &value)) {
+		if (value) {
+			// toggle enable if value is non-zero
+			curState.bRunning = !curState.bRunning;
+		} else {
+			// otherwise disable output
+			curState.bRunning = 0;
 		}
 
-		if (curTimeMs <= state->halfPeriodMs) {
-			// first half period, linear increasing function from 0
-			GPIO_Write(WAVEFORM_PORT, (uint32_t)state->amplitude * curTimeMs / state->halfPeriodMs);
+		if (curState.bRunning) {
+			// we are now enabled, start the output
+			start_output(&curState);
 		} else {
-			// second half period, linear decreasing function from periodMs
-			GPIO_Write(WAVEFORM_PORT, (uint32_t)state->amplitude * (state->periodMs - curTimeMs) / state->halfPeriodMs);
+			// we are now disabled, stop the output if it's this waveform's
+			if (wave_out_stop(&stateSnap)) {
+				// set output to 0
+				GPIO_Write(WAVEFORM_PORT, 0);
+			}
+			// reset phase
+			phase = 0;
 		}
+	} else if (bChanged && curState.bRunning) {
+		// the output picks up every param in the batch at once
+		start_output(&curState);
 	}
-	osMutexRelease(M_triangle_state);
+}
+
+/** Operations on the triangle waveform for the waveform manager. */
+waveform_ops_t const triangle_wave_ops = {
+	.init = triangle_init,
+	.set = triangle_set,
+	.get = triangle_get,
+};
 
-	++curTimeMs;
+static inline uint16_t triangle_sample(triangle_state_t const *state, uint32_t curPhase)
+{
+	// linear increasing function for the first half period, then decreasing back to 0
+	return dds_scale(dds_triangle(curPhase), state->ampScale);
+}
+
+static void triangle_run(void const *arg, uint16_t *buf, uint16_t len)
+{
+	triangle_state_t const *state = arg;
+
+	for (uint16_t i = 0; i < len; ++i) {
+		// step the phase, the accumulator wraps around at the end of each period
+		buf[i] = triangle_sample(state, dds_next(&phase, state->tuningWord));
+	}
 }
@@ -1,4 +1,5 @@
 #include <stm32f10x.h>
+#include "uart_tx.h"
 
 /*----------------------------------------------------------------------------
   Initialize UART pins, Baudrate
@@ -30,12 +31,12 @@ void USART1_Init (void) {
 
 /*----------------------------------------------------------------------------
   SendChar
-  Write character to Serial Port.
+  Queue character for the Serial Port, sent by DMA.
  *----------------------------------------------------------------------------*/
 int SendChar (int ch)  {
+  char const c = ch;
 
-  while (!(USART1->SR & USART_SR_TXE));
-  USART1->DR = (ch & 0x1FF);
+  uart_tx_send(&c, 1);                    /* waits only if the ring is full   */
 
   return (ch);
 }
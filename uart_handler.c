@@ -8,19 +8,22 @@
 #include "uart_handler.h"
 #include "global.h"
 #include "uart.h"
-#include "pwm_wave.h"
-#include "sawtooth_wave.h"
-#include "sine_wave.h"
-#include "triangle_wave.h"
+#include "cmd_link.h"
+#include "uart_rx.h"
+#include "uart_tx.h"
+#include "cpu_load.h"
+#include "metrics.h"
+#include "profile.h"
+#include "stack_watch.h"
+#include "trace.h"
 #include "utils.h"
+#include "waveform.h"
 #include "waveform_cfg.h"
+#include "wave_out.h"
+#include <string.h>
 
 /// UART PROCESSING VARIABLES AND PROTOS
 
-// message queue of characters from the user
-static osMessageQDef(uart_q, 0x10, uint8_t);
-static osMessageQId Q_uart_id;
-
 /** Reads a character from the user. */
 static uint8_t ReadChar(void);
 /**
@@ -34,10 +37,33 @@ static void SendText(char const *text);
 /** Parses a u16, saturating at u16 MAX (0xFFFF). */
 static int32_t parse_u16_saturate(char *str);
 /**
- * Converts a u16 to a string, filling the provided buffer.
+ * Parses a decimal number with up to decimals digits after the point, scaled by 10^decimals.
+ * Needs a digit on at least one side of the point.
+ * Saturates at i32 MAX (0x7FFFFFFF), returns -1 if the input is invalid.
+ */
+static int32_t parse_fixed_saturate(char *str, uint8_t decimals);
+/**
+ * Converts a u32 to a string, filling the provided buffer.
+ * Returns the length of the string, or -1 if there was an error.
+ */
+static int32_t u32_to_str(uint32_t value, char *str, size_t cap);
+/**
+ * Converts a u32 scaled by 10^decimals to a decimal string, filling the provided buffer.
  * Returns the length of the string, or -1 if there was an error.
  */
-static int32_t u16_to_str(uint16_t value, char *str, size_t cap);
+static int32_t fixed_to_str(uint32_t value, uint8_t decimals, char *str, size_t cap);
+/** Sends the status of the DMA output engine to the user. */
+static void SendOutputStatus(void);
+/** Sends the CPU load and the time recorded by each profiler probe to the user. */
+static void SendProfileReport(void);
+/** Sends the unused stack of each thread to the user. */
+static void SendStackReport(void);
+/** Sends every runtime counter and gauge to the user. */
+static void SendStats(void);
+/** Sends the event trace to the user as hex records for tools/trace_decode.py, then clears it. */
+static void SendTrace(void);
+/** Converts the low digits nibbles of a u32 to a hex string, str needs room for digits + 1 chars. */
+static void u32_to_hex(uint32_t value, uint8_t digits, char *str);
 
 /// Program state
 
@@ -69,24 +95,31 @@ typedef enum _waveform_t {
 typedef enum _param_t {
 	NO_PARAM,
 	AMPLITUDE,
-	PERIOD,
+	FREQUENCY,
 	DUTY_CYCLE,
+	SAMPLE_RATE,
 	ENABLE_OUT,
+	/** Every param of the waveform, applied together */
+	ALL_PARAMS,
 } param_t;
 
+/**
+ * Prompts the user for the value of a config param and adds it to the batch.
+ * Returns non-zero if the value is valid.
+ */
+static uint8_t ReadParam(param_t param, waveform_batch_t *batch);
+
 void uart_handler_init(void)
 {
 	// initialize USART1
 	USART1_Init();
 
-	// Configure USART1 interrupt so we can read user inputs using interrupt
-	NVIC->ICPR[USART1_IRQn/32] = 1UL << (USART1_IRQn%32);	// clear any previous pending interrupt flag
-	NVIC->IP[USART1_IRQn] = 0x80;		// set priority to 0x80
-	NVIC->ISER[USART1_IRQn/32] = 1UL << (USART1_IRQn%32);	// set interrupt enable bit
-	USART1->CR1 |= USART_CR1_RXNEIE; // enable USART receiver not empty interrupt
-
-	// create the message queue
-	Q_uart_id = osMessageCreate(osMessageQ(uart_q), NULL);
+	// user input is received by DMA into the receive ring
+	uart_rx_init();
+	// output is sent by DMA from the transmit ring
+	uart_tx_init();
+	// scripts can switch to binary commands at any prompt
+	cmd_link_init();
 }
 
 /**
@@ -98,37 +131,32 @@ static program_state_t process_config_pwm(param_t *param)
 {
 	SendText("Waveform: PWM\n");
 
-	char line[8] = {0};
-	waveform_cfg_t cfg;
+	uint32_t const start = profile_now();
+	char line[12] = {0};
+
+	// one consistent copy of the config, without waiting on the waveform thread
+	waveform_status_t status;
+	waveform_get_status(WAVEFORM_PWM, &status);
 
-	// fetch and output the amplitude of the waveform
-	cfg.type = PARAM_AMPLITUDE;
-	pwm_wave_recv_cfg(&cfg);
-	u16_to_str(cfg.value, line, sizeof(line));
+	// output the amplitude of the waveform
+	u32_to_str(status.amplitude, line, sizeof(line));
 	SendText("Amplitude: ");
 	SendText(line);
 	SendText("%\n");
 
-	// fetch and output the period of the waveform
-	cfg.type = PARAM_PERIOD_MS;
-	pwm_wave_recv_cfg(&cfg);
-	u16_to_str(cfg.value, line, sizeof(line));
-	SendText("Period: ");
+	// output the frequency of the waveform
+	fixed_to_str(status.freqMhz, 3, line, sizeof(line));
+	SendText("Frequency: ");
 	SendText(line);
-	SendText(" ms\n");
+	SendText(" Hz\n");
 
-	// fetch and output the duty cycle of the waveform
-	cfg.type = PARAM_DUTYCYCLE;
-	pwm_wave_recv_cfg(&cfg);
-	u16_to_str(cfg.value, line, sizeof(line));
+	// output the duty cycle of the waveform
+	u32_to_str(status.dutyCycle, line, sizeof(line));
 	SendText("Duty Cycle: ");
 	SendText(line);
 	SendText("%\n");
 
-	// fetch the enable state of the waveform
-	cfg.type = PARAM_ENABLE;
-	pwm_wave_recv_cfg(&cfg);
-	uint8_t const bEnabled = cfg.value;
+	uint8_t const bEnabled = status.bEnabled;
 
 	SendChar('\n');
 
@@ -139,8 +167,11 @@ static program_state_t process_config_pwm(param_t *param)
 		SendText("[0] Enable Output\n");
 	}
 	SendText("[1] Change Amplitude\n");
-	SendText("[2] Change Period\n");
+	SendText("[2] Change Frequency\n");
 	SendText("[3] Change Duty Cycle\n");
+	SendText("[4] Change All\n");
+
+	profile_end(PROFILE_MENU_RENDER, start);
 
 	// read the user selection
 	SendText("Selection: ");
@@ -152,11 +183,14 @@ static program_state_t process_config_pwm(param_t *param)
 			*param = AMPLITUDE;
 			break;
 		case '2':
-			*param = PERIOD;
+			*param = FREQUENCY;
 			break;
 		case '3':
 			*param = DUTY_CYCLE;
 			break;
+		case '4':
+			*param = ALL_PARAMS;
+			break;
 		case '0':
 			*param = ENABLE_OUT;
 			break;
@@ -168,7 +202,7 @@ static program_state_t process_config_pwm(param_t *param)
 				.type = PARAM_ENABLE,
 				.value = 0,
 			};
-			pwm_wave_send_cfg(cfg);
+			waveform_send_cfg(WAVEFORM_PWM, cfg);
 			// go back to waveform selection screen
 			return SELECT_WAVE;
 		}
@@ -192,29 +226,37 @@ static program_state_t process_config_saw(param_t *param)
 {
 	SendText("Waveform: Sawtooth\n");
 
-	char line[8] = {0};
-	waveform_cfg_t cfg;
+	uint32_t const start = profile_now();
+	char line[12] = {0};
 
-	// fetch and output the amplitude of the waveform
-	cfg.type = PARAM_AMPLITUDE;
-	sawtooth_wave_recv_cfg(&cfg);
-	u16_to_str(cfg.value, line, sizeof(line));
+	// one consistent copy of the config, without waiting on the waveform thread
+	waveform_status_t status;
+	waveform_get_status(WAVEFORM_SAWTOOTH, &status);
+
+	// output the amplitude of the waveform
+	u32_to_str(status.amplitude, line, sizeof(line));
 	SendText("Amplitude: ");
 	SendText(line);
 	SendText("%\n");
 
-	// fetch and output the period of the waveform
-	cfg.type = PARAM_PERIOD_MS;
-	sawtooth_wave_recv_cfg(&cfg);
-	u16_to_str(cfg.value, line, sizeof(line));
-	SendText("Period: ");
+	// output the frequency of the waveform
+	fixed_to_str(status.freqMhz, 3, line, sizeof(line));
+	SendText("Frequency: ");
+	SendText(line);
+	SendText(" Hz\n");
+
+	// output the sample rate of the waveform
+	u32_to_str(status.sampleRateHz, line, sizeof(line));
+	SendText("Sample Rate: ");
 	SendText(line);
-	SendText(" ms\n");
+	SendText(" SPS\n");
 
-	// fetch the enable state of the waveform
-	cfg.type = PARAM_ENABLE;
-	sawtooth_wave_recv_cfg(&cfg);
-	uint8_t const bEnabled = cfg.value;
+	uint8_t const bEnabled = status.bEnabled;
+
+	if (bEnabled) {
+		// output the status of the output engine driving the waveform
+		SendOutputStatus();
+	}
 
 	SendChar('\n');
 
@@ -225,7 +267,11 @@ static program_state_t process_config_saw(param_t *param)
 		SendText("[0] Enable Output\n");
 	}
 	SendText("[1] Change Amplitude\n");
-	SendText("[2] Change Period\n");
+	SendText("[2] Change Frequency\n");
+	SendText("[3] Change Sample Rate\n");
+	SendText("[4] Change All\n");
+
+	profile_end(PROFILE_MENU_RENDER, start);
 
 	// read the user selection
 	SendText("Selection: ");
@@ -237,7 +283,13 @@ static program_state_t process_config_saw(param_t *param)
 			*param = AMPLITUDE;
 			break;
 		case '2':
-			*param = PERIOD;
+			*param = FREQUENCY;
+			break;
+		case '3':
+			*param = SAMPLE_RATE;
+			break;
+		case '4':
+			*param = ALL_PARAMS;
 			break;
 		case '0':
 			*param = ENABLE_OUT;
@@ -250,7 +302,7 @@ static program_state_t process_config_saw(param_t *param)
 				.type = PARAM_ENABLE,
 				.value = 0,
 			};
-			sawtooth_wave_send_cfg(cfg);
+			waveform_send_cfg(WAVEFORM_SAWTOOTH, cfg);
 			// go back to waveform selection screen
 			return SELECT_WAVE;
 		}
@@ -274,29 +326,37 @@ static program_state_t process_config_sin(param_t *param)
 {
 	SendText("Waveform: Sine\n");
 
-	char line[8] = {0};
-	waveform_cfg_t cfg;
+	uint32_t const start = profile_now();
+	char line[12] = {0};
 
-	// fetch and output the amplitude of the waveform
-	cfg.type = PARAM_AMPLITUDE;
-	sine_wave_recv_cfg(&cfg);
-	u16_to_str(cfg.value, line, sizeof(line));
+	// one consistent copy of the config, without waiting on the waveform thread
+	waveform_status_t status;
+	waveform_get_status(WAVEFORM_SINE, &status);
+
+	// output the amplitude of the waveform
+	u32_to_str(status.amplitude, line, sizeof(line));
 	SendText("Amplitude: ");
 	SendText(line);
 	SendText("%\n");
 
-	// fetch and output the period of the waveform
-	cfg.type = PARAM_PERIOD_MS;
-	sine_wave_recv_cfg(&cfg);
-	u16_to_str(cfg.value, line, sizeof(line));
-	SendText("Period: ");
+	// output the frequency of the waveform
+	fixed_to_str(status.freqMhz, 3, line, sizeof(line));
+	SendText("Frequency: ");
+	SendText(line);
+	SendText(" Hz\n");
+
+	// output the sample rate of the waveform
+	u32_to_str(status.sampleRateHz, line, sizeof(line));
+	SendText("Sample Rate: ");
 	SendText(line);
-	SendText(" ms\n");
+	SendText(" SPS\n");
 
-	// fetch the enable state of the waveform
-	cfg.type = PARAM_ENABLE;
-	sine_wave_recv_cfg(&cfg);
-	uint8_t const bEnabled = cfg.value;
+	uint8_t const bEnabled = status.bEnabled;
+
+	if (bEnabled) {
+		// output the status of the output engine driving the waveform
+		SendOutputStatus();
+	}
 
 	SendChar('\n');
 
@@ -307,7 +367,11 @@ static program_state_t process_config_sin(param_t *param)
 		SendText("[0] Enable Output\n");
 	}
 	SendText("[1] Change Amplitude\n");
-	SendText("[2] Change Period\n");
+	SendText("[2] Change Frequency\n");
+	SendText("[3] Change Sample Rate\n");
+	SendText("[4] Change All\n");
+
+	profile_end(PROFILE_MENU_RENDER, start);
 
 	// read the user selection
 	SendText("Selection: ");
@@ -319,7 +383,13 @@ static program_state_t process_config_sin(param_t *param)
 			*param = AMPLITUDE;
 			break;
 		case '2':
-			*param = PERIOD;
+			*param = FREQUENCY;
+			break;
+		case '3':
+			*param = SAMPLE_RATE;
+			break;
+		case '4':
+			*param = ALL_PARAMS;
 			break;
 		case '0':
 			*param = ENABLE_OUT;
@@ -332,7 +402,7 @@ static program_state_t process_config_sin(param_t *param)
 				.type = PARAM_ENABLE,
 				.value = 0,
 			};
-			sine_wave_send_cfg(cfg);
+			waveform_send_cfg(WAVEFORM_SINE, cfg);
 			// go back to waveform selection screen
 			return SELECT_WAVE;
 		}
@@ -356,29 +426,37 @@ static program_state_t process_config_tri(param_t *param)
 {
 	SendText("Waveform: Triangle\n");
 
-	char line[8] = {0};
-	waveform_cfg_t cfg;
+	uint32_t const start = profile_now();
+	char line[12] = {0};
+
+	// one consistent copy of the config, without waiting on the waveform thread
+	waveform_status_t status;
+	waveform_get_status(WAVEFORM_TRIANGLE, &status);
 
-	// fetch and output the amplitude of the waveform
-	cfg.type = PARAM_AMPLITUDE;
-	triangle_wave_recv_cfg(&cfg);
-	u16_to_str(cfg.value, line, sizeof(line));
+	// output the amplitude of the waveform
+	u32_to_str(status.amplitude, line, sizeof(line));
 	SendText("Amplitude: ");
 	SendText(line);
 	SendText("%\n");
 
-	// fetch and output the period of the waveform
-	cfg.type = PARAM_PERIOD_MS;
-	triangle_wave_recv_cfg(&cfg);
-	u16_to_str(cfg.value, line, sizeof(line));
-	SendText("Period: ");
+	// output the frequency of the waveform
+	fixed_to_str(status.freqMhz, 3, line, sizeof(line));
+	SendText("Frequency: ");
 	SendText(line);
-	SendText(" ms\n");
+	SendText(" Hz\n");
 
-	// fetch the enable state of the waveform
-	cfg.type = PARAM_ENABLE;
-	triangle_wave_recv_cfg(&cfg);
-	uint8_t const bEnabled = cfg.value;
+	// output the sample rate of the waveform
+	u32_to_str(status.sampleRateHz, line, sizeof(line));
+	SendText("Sample Rate: ");
+	SendText(line);
+	SendText(" SPS\n");
+
+	uint8_t const bEnabled = status.bEnabled;
+
+	if (bEnabled) {
+		// output the status of the output engine driving the waveform
+		SendOutputStatus();
+	}
 
 	SendChar('\n');
 
@@ -389,7 +467,11 @@ static program_state_t process_config_tri(param_t *param)
 		SendText("[0] Enable Output\n");
 	}
 	SendText("[1] Change Amplitude\n");
-	SendText("[2] Change Period\n");
+	SendText("[2] Change Frequency\n");
+	SendText("[3] Change Sample Rate\n");
+	SendText("[4] Change All\n");
+
+	profile_end(PROFILE_MENU_RENDER, start);
 
 	// read the user selection
 	SendText("Selection: ");
@@ -401,7 +483,13 @@ static program_state_t process_config_tri(param_t *param)
 			*param = AMPLITUDE;
 			break;
 		case '2':
-			*param = PERIOD;
+			*param = FREQUENCY;
+			break;
+		case '3':
+			*param = SAMPLE_RATE;
+			break;
+		case '4':
+			*param = ALL_PARAMS;
 			break;
 		case '0':
 			*param = ENABLE_OUT;
@@ -414,7 +502,7 @@ static program_state_t process_config_tri(param_t *param)
 				.type = PARAM_ENABLE,
 				.value = 0,
 			};
-			triangle_wave_send_cfg(cfg);
+			waveform_send_cfg(WAVEFORM_TRIANGLE, cfg);
 			// go back to waveform selection screen
 			return SELECT_WAVE;
 		}
@@ -431,6 +519,9 @@ static program_state_t process_config_tri(param_t *param)
 
 void uart_handler_thread(void const *arg)
 {
+	// find the bottom of this thread's stack for the high-water mark
+	stack_watch_register(STACK_WATCH_UART);
+
 	// start on the waveform selection screen
 	program_state_t state = SELECT_WAVE;
 	// initially no waveform is selected
@@ -438,11 +529,6 @@ void uart_handler_thread(void const *arg)
 	// initially no param is selected
 	param_t param = NO_PARAM;
 
-	#define LINE_CAP 16
-	// buffer for reading lines from user
-	char line[LINE_CAP] = {0};
-	size_t line_len = 0;
-
 	SendText("WAVEFORM GENERATOR\n");
 
 	while (1) {
@@ -457,6 +543,11 @@ void uart_handler_thread(void const *arg)
 				SendText("[2] Triangle\n");
 				SendText("[3] Sawtooth\n");
 				SendText("[4] Sine\n");
+				SendText("[5] CPU Load and Profiler Report\n");
+				SendText("[6] Reset Profiler and Stats\n");
+				SendText("[7] Stack Report\n");
+				SendText("[8] Dump Event Trace\n");
+				SendText("[9] Stats\n");
 
 				// read user selection
 				SendText("Selection: ");
@@ -480,6 +571,24 @@ void uart_handler_thread(void const *arg)
 						wave = WAVE_SIN;
 						state = CONFIG_WAVE;
 						break;
+					case '5':
+						// stay on the waveform selection screen
+						SendProfileReport();
+						break;
+					case '6':
+						profile_reset();
+						metrics_reset();
+						SendText("Profiler and stats reset\n");
+						break;
+					case '7':
+						SendStackReport();
+						break;
+					case '8':
+						SendTrace();
+						break;
+					case '9':
+						SendStats();
+						break;
 					default:
 						wave = WAVE_NONE;
 						SendText("Invalid input\n");
@@ -514,82 +623,31 @@ void uart_handler_thread(void const *arg)
 			// parameter configuration screen
 			case CONFIG_PARAM:
 			{
-				waveform_cfg_t cfg;
-				uint8_t bValid = 0;
-
-				switch (param) {
-					case AMPLITUDE:
-					{
-						SendText("Amplitude [0-100%]: ");
-						line_len = ReadLine(line, LINE_CAP);
-
-						int32_t const value = parse_u16_saturate(line);
-						// make sure the value is in the range [0, 100]
-						if (value >= 0 && value <= 100) {
-							// value is valid
-							cfg.type = PARAM_AMPLITUDE;
-							cfg.value = value;
-							bValid = 1;
-						}
-						break;
-					}
-					case PERIOD:
-					{
-						SendText("Period [0-60000 ms]: ");
-						line_len = ReadLine(line, LINE_CAP);
-
-						int32_t const value = parse_u16_saturate(line);
-						// make sure the value is in the range [0, 60000]
-						if (value >= 0 && value <= 60000) {
-							// value is valid
-							cfg.type = PARAM_PERIOD_MS;
-							cfg.value = value;
-							bValid = 1;
-						}
-						break;
-					}
-					case DUTY_CYCLE:
-					{
-						SendText("Duty Cycle [0-100%]: ");
-						line_len = ReadLine(line, LINE_CAP);
-
-						int32_t const value = parse_u16_saturate(line);
-						// make sure the value is in the range [0, 100]
-						if (value >= 0 && value <= 100) {
-							// value is valid
-							cfg.type = PARAM_DUTYCYCLE;
-							cfg.value = value;
-							bValid = 1;
-						}
-						break;
-					}
-					case ENABLE_OUT:
-					{
-						// toggle enable (value = 1)
-						cfg.type = PARAM_ENABLE;
-						cfg.value = 1;
-						bValid = 1;
-						break;
-					}
+				waveform_batch_t batch = {0};
+				uint8_t bValid;
 
-					default:
-						break;
+				if (param == ALL_PARAMS) {
+					// read every param first, then send them together so the output never mixes old and new values
+					bValid = ReadParam(AMPLITUDE, &batch) && ReadParam(FREQUENCY, &batch)
+						&& ReadParam(wave == WAVE_PWM ? DUTY_CYCLE : SAMPLE_RATE, &batch);
+				} else {
+					bValid = ReadParam(param, &batch);
 				}
-				
+
 				if (bValid) {
-					// send config param
+					// send the config params
 					switch (wave) {
 						case WAVE_PWM:
-							pwm_wave_send_cfg(cfg);
+							waveform_send_batch(WAVEFORM_PWM, &batch);
 							break;
 						case WAVE_SAW:
-							sawtooth_wave_send_cfg(cfg);
+							waveform_send_batch(WAVEFORM_SAWTOOTH, &batch);
 							break;
 						case WAVE_SIN:
-							sine_wave_send_cfg(cfg);
+							waveform_send_batch(WAVEFORM_SINE, &batch);
 							break;
 						case WAVE_TRI:
-							triangle_wave_send_cfg(cfg);
+							waveform_send_batch(WAVEFORM_TRIANGLE, &batch);
 							break;
 
 						default:
@@ -610,11 +668,108 @@ void uart_handler_thread(void const *arg)
 
 /// UART PROCESSING FUNCTIONS
 
+static uint8_t ReadParam(param_t param, waveform_batch_t *batch)
+{
+	// buffer for reading lines from user
+	char line[16] = {0};
+	waveform_cfg_t cfg;
+	uint8_t bValid = 0;
+
+	switch (param) {
+		case AMPLITUDE:
+		{
+			SendText("Amplitude [0-100%]: ");
+			ReadLine(line, sizeof(line));
+
+			int32_t const value = parse_u16_saturate(line);
+			// make sure the value is in the range [0, 100]
+			if (value >= 0 && value <= 100) {
+				// value is valid
+				cfg.type = PARAM_AMPLITUDE;
+				cfg.value = value;
+				bValid = 1;
+			}
+			break;
+		}
+		case FREQUENCY:
+		{
+			SendText("Frequency [0-50000.000 Hz]: ");
+			ReadLine(line, sizeof(line));
+
+			// frequency is sent in mHz
+			int32_t const value = parse_fixed_saturate(line, 3);
+			// make sure the value is in the range [0, 50000 Hz]
+			if (value >= 0 && value <= 50000000) {
+				// value is valid
+				cfg.type = PARAM_FREQ_MHZ;
+				cfg.value = value;
+				bValid = 1;
+			}
+			break;
+		}
+		case DUTY_CYCLE:
+		{
+			SendText("Duty Cycle [0-100%]: ");
+			ReadLine(line, sizeof(line));
+
+			int32_t const value = parse_u16_saturate(line);
+			// make sure the value is in the range [0, 100]
+			if (value >= 0 && value <= 100) {
+				// value is valid
+				cfg.type = PARAM_DUTYCYCLE;
+				cfg.value = value;
+				bValid = 1;
+			}
+			break;
+		}
+		case SAMPLE_RATE:
+		{
+			SendText("[1] 1 kSPS\n");
+			SendText("[2] 10 kSPS\n");
+			SendText("[3] 50 kSPS\n");
+			SendText("[4] 100 kSPS\n");
+			SendText("Sample Rate: ");
+			char const selection = ReadChar();
+			SendChar('\n');
+
+			// each rate divides the timer clock, so the sample time is exact
+			static uint32_t const rates[] = {1000, 10000, 50000, 100000};
+			if (selection >= '1' && selection < '1' + sizeof(rates) / sizeof(rates[0])) {
+				// value is valid
+				cfg.type = PARAM_SAMPLE_RATE;
+				cfg.value = rates[selection - '1'];
+				bValid = 1;
+			}
+			break;
+		}
+		case ENABLE_OUT:
+		{
+			// toggle enable (value = 1)
+			cfg.type = PARAM_ENABLE;
+			cfg.value = 1;
+			bValid = 1;
+			break;
+		}
+
+		default:
+			break;
+	}
+
+	if (bValid) {
+		waveform_batch_add(batch, cfg);
+	}
+	return bValid;
+}
+
 static uint8_t ReadChar(void)
 {
-	// wait for a character in the message queue
-	osEvent result = osMessageGet(Q_uart_id, osWaitForever);
-	uint8_t input = result.value.v;
+	// wait for a character from the receive ring
+	uint8_t input = uart_rx_getc();
+	while (input == CMD_LINK_DELIM) {
+		// a script opened the binary link, the prompt is still waiting once it's closed
+		cmd_link_run();
+		input = uart_rx_getc();
+	}
 	if (input == '\b') {
 		// backspace, clear the last character from the screen
 		SendText("\b \b");
@@ -631,17 +786,18 @@ static uint8_t ReadChar(void)
 
 static size_t ReadLine(char *line, size_t line_cap)
 {
-	osEvent result;
 	uint8_t input;
 	
 	size_t line_len = 0;
 
 	while (1) {
-		// wait for a character in the message queue
-		result = osMessageGet(Q_uart_id, osWaitForever);
-		input = result.value.v;
+		// wait for a character from the receive ring
+		input = uart_rx_getc();
 
-		if (input == '\b') {
+		if (input == CMD_LINK_DELIM) {
+			// a script opened the binary link, the line is still waiting once it's closed
+			cmd_link_run();
+		} else if (input == '\b') {
 			// backspace; if we have characters in the line, remove the last char
 			if (line_len > 0) {
 				line[--line_len] = '\0';
@@ -668,10 +824,199 @@ static size_t ReadLine(char *line, size_t line_cap)
 
 static void SendText(char const *text)
 {
-	while (*text) {
-		SendChar(*text);
-		++text;
+	uint32_t const start = profile_now();
+	// queue the whole string at once, DMA1 channel 4 sends it from the transmit ring
+	uart_tx_send(text, strlen(text));
+	profile_end(PROFILE_SEND_TEXT, start);
+}
+
+static void SendOutputStatus(void)
+{
+	char line[12] = {0};
+	wave_out_status_t status;
+	wave_out_get_status(&status);
+
+	switch (status.mode) {
+		case WAVE_OUT_TABLE:
+		{
+			// whole periods are looped from RAM
+			SendText("Output: ");
+			u32_to_str(status.len, line, sizeof(line));
+			SendText(line);
+			SendText("-sample table of ");
+			u32_to_str(status.periods, line, sizeof(line));
+			SendText(line);
+			SendText(status.periods == 1 ? " period (" : " periods (");
+			u32_to_str(status.len * sizeof(uint16_t), line, sizeof(line));
+			SendText(line);
+			SendText(" B), rebuilt in ");
+			u32_to_str(status.renderUs, line, sizeof(line));
+			SendText(line);
+			SendText(" us\n");
+			break;
+		}
+		case WAVE_OUT_STREAM:
+		{
+			// period too long for the table, generated live
+			SendText("Output: streamed live (");
+			u32_to_str(status.len * sizeof(uint16_t), line, sizeof(line));
+			SendText(line);
+			SendText(" B)\n");
+			// how close the refill interrupt came to its deadline
+			SendText("Refill jitter: ");
+			u32_to_str(status.refillJitterCycles, line, sizeof(line));
+			SendText(line);
+			SendText(" cycles, min slack: ");
+			u32_to_str(status.refillSlack, line, sizeof(line));
+			SendText(line);
+			SendText(" samples\n");
+			// refills that interrupted a config update and played the state from before it
+			SendText("Stale state reuses: ");
+			u32_to_str(status.refillStaleReads, line, sizeof(line));
+			SendText(line);
+			SendChar('\n');
+			break;
+		}
+		default:
+			return;
+	}
+
+	// a table can run below the selected rate to fit a whole number of samples per period
+	SendText("Output Rate: ");
+	u32_to_str(status.rateHz, line, sizeof(line));
+	SendText(line);
+	SendText(" SPS\n");
+}
+
+static void SendProfileReport(void)
+{
+	char line[12] = {0};
+	profile_stats_t stats;
+
+	// busy fraction of the last 100 ms and 1 s
+	SendText("CPU Load: ");
+	fixed_to_str(cpu_load_permille(CPU_LOAD_100MS), 1, line, sizeof(line));
+	SendText(line);
+	SendText("% (100 ms), ");
+	fixed_to_str(cpu_load_permille(CPU_LOAD_1S), 1, line, sizeof(line));
+	SendText(line);
+	SendText("% (1 s)\n");
+
+	// the tick is stopped while idle, so this is mostly interrupts that did real work
+	SendText("Wakeups: ");
+	u32_to_str(cpu_load_wakeups(CPU_LOAD_1S), line, sizeof(line));
+	SendText(line);
+	SendText("/s\n");
+
+	SendText("Probe: count, min / mean / max " PROFILE_UNIT "\n");
+	for (profile_probe_t probe = 0; probe < PROFILE_NUM_PROBES; ++probe) {
+		profile_read(probe, &stats);
+
+		SendText(profile_name(probe));
+		SendText(": ");
+		u32_to_str(stats.count, line, sizeof(line));
+		SendText(line);
+		if (stats.count == 0) {
+			// nothing recorded yet
+			SendChar('\n');
+			continue;
+		}
+		SendText(", ");
+		u32_to_str(stats.min, line, sizeof(line));
+		SendText(line);
+		SendText(" / ");
+		u32_to_str(stats.total / stats.count, line, sizeof(line));
+		SendText(line);
+		SendText(" / ");
+		u32_to_str(stats.max, line, sizeof(line));
+		SendText(line);
+		SendChar('\n');
+	}
+}
+
+static void SendStackReport(void)
+{
+	char line[12] = {0};
+
+	SendText("Thread: unused stack\n");
+	for (stack_watch_thread_t thread = 0; thread < STACK_WATCH_NUM_THREADS; ++thread) {
+		SendText(stack_watch_name(thread));
+		SendText(": ");
+
+		int32_t const free = stack_watch_free_words(thread);
+		if (free < 0) {
+			// not started yet, or the bottom word was overwritten by an overflow
+			SendText("unknown\n");
+			continue;
+		}
+		u32_to_str(free, line, sizeof(line));
+		SendText(line);
+		SendText(" words\n");
+	}
+}
+
+static void SendStats(void)
+{
+	char line[12] = {0};
+	uint32_t value;
+	uint32_t max;
+
+	SendText("Metric: value (max)\n");
+	for (metric_t metric = 0; metric < METRIC_NUM; ++metric) {
+		metrics_read(metric, &value, &max);
+
+		SendText(metrics_name(metric));
+		SendText(": ");
+		u32_to_str(value, line, sizeof(line));
+		SendText(line);
+		if (metrics_is_gauge(metric)) {
+			// a gauge's high-water mark shows how close it came to full
+			SendText(" (");
+			u32_to_str(max, line, sizeof(line));
+			SendText(line);
+			SendChar(')');
+		}
+		SendChar('\n');
+	}
+}
+
+static void SendTrace(void)
+{
+	char line[12] = {0};
+	trace_record_t record;
+
+	// the UART thread is the lowest priority thread that records, so the buffer is settled
+	uint16_t const count = trace_pause();
+
+	// the clock rate lets the decoder turn timestamps into time
+	SendText("TRACE BEGIN ");
+	u32_to_str(SystemCoreClock, line, sizeof(line));
+	SendText(line);
+	SendChar(' ');
+	u32_to_str(count, line, sizeof(line));
+	SendText(line);
+	SendChar('\n');
+
+	// one record per line: time, event, arg, data
+	for (uint16_t i = 0; i < count; ++i) {
+		trace_read(i, &record);
+		u32_to_hex(record.time, 8, line);
+		SendText(line);
+		SendChar(' ');
+		u32_to_hex(record.event, 2, line);
+		SendText(line);
+		SendChar(' ');
+		u32_to_hex(record.arg, 2, line);
+		SendText(line);
+		SendChar(' ');
+		u32_to_hex(record.data, 4, line);
+		SendText(line);
+		SendChar('\n');
 	}
+	SendText("TRACE END\n");
+
+	// start over so the next dump only has what happened after this one
+	trace_resume();
 }
 
 static int32_t parse_u16_saturate(char *str)
@@ -692,12 +1037,53 @@ static int32_t parse_u16_saturate(char *str)
 	return retval;
 }
 
-static int32_t u16_to_str(uint16_t value, char *str, size_t cap)
+static int32_t parse_fixed_saturate(char *str, uint8_t decimals)
 {
-	int32_t str_len = 0;
+	int64_t retval = 0;
+	// digits after the point, -1 until the point is found
+	int8_t fracDigits = -1;
+	// a point on its own isn't a number
+	uint8_t bDigits = 0;
+	for (; *str; ++str) {
+		if (*str == '.' && fracDigits < 0) {
+			fracDigits = 0;
+			continue;
+		}
+		if (*str < '0' || *str > '9' || fracDigits >= decimals) {
+			// invalid input, or more precision than we can hold
+			return -1;
+		}
+		bDigits = 1;
+		if (fracDigits >= 0) {
+			++fracDigits;
+		}
+		retval *= 10;
+		retval += *str - '0';
+		if (retval >= 0x7FFFFFFF) {
+			// saturate at i32 max
+			return 0x7FFFFFFF;
+		}
+	}
+	if (!bDigits) {
+		return -1;
+	}
+	// scale up for the missing digits after the point
+	for (int8_t i = (fracDigits < 0) ? 0 : fracDigits; i < decimals; ++i) {
+		retval *= 10;
+		if (retval >= 0x7FFFFFFF) {
+			return 0x7FFFFFFF;
+		}
+	}
+	return retval;
+}
+
+static int32_t u32_to_str(uint32_t value, char *str, size_t cap)
+{
+	// 0 still takes one digit
+	int32_t str_len = 1;
 
 	// calculate what the string length should be
-	uint16_t value_tmp = value;
+	uint32_t value_tmp = value / 10;
 	while (value_tmp) {
 		value_tmp /= 10;
 		++str_len;
@@ -721,12 +1107,44 @@ static int32_t u16_to_str(uint16_t value, char *str, size_t cap)
 	return str_len;
 }
 
-/*-----------------------------------------------------------------------------
-	USART1 IRQ Handler
-		The hardware automatically clears the interrupt flag, once the ISR is entered
- *---------------------------------------------------------------------------*/
-void USART1_IRQHandler(void)
+static int32_t fixed_to_str(uint32_t value, uint8_t decimals, char *str, size_t cap)
+{
+	uint32_t scale = 1;
+	for (uint8_t i = 0; i < decimals; ++i) {
+		scale *= 10;
+	}
+
+	// whole part, then the point and the digits after it
+	int32_t str_len = u32_to_str(value / scale, str, cap);
+	if (str_len < 0 || decimals == 0) {
+		return str_len;
+	}
+	if (str_len + 1 + decimals >= cap) {
+		// string buffer not large enough, return error
+		str[0] = '\0';
+		return -1;
+	}
+	str[str_len++] = '.';
+
+	// fill the fraction in from its last digit, keeping the leading zeros
+	uint32_t frac = value % scale;
+	for (int i = str_len + decimals - 1; i >= str_len; --i) {
+		str[i] = (frac % 10) + '0';
+		frac /= 10;
+	}
+	str_len += decimals;
+	// ensure null termination
+	str[str_len] = '\0';
+	return str_len;
+}
+
+static void u32_to_hex(uint32_t value, uint8_t digits, char *str)
 {
-	uint8_t const intKey = (int8_t)(USART1->DR & 0x1FF);
-	osMessagePut(Q_uart_id, intKey, 0);
+	static char const hexDigits[] = "0123456789abcdef";
+	// fill in the lowest digit at the end and move left
+	for (int i = digits - 1; i >= 0; --i) {
+		str[i] = hexDigits[value & 0xF];
+		value >>= 4;
+	}
+	str[digits] = '\0';
 }
\ No newline at end of file
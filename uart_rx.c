@@ -0,0 +1,178 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "uart_rx.h"
+#include "global.h"
+#include "metrics.h"
+#include "profile.h"
+#include "trace.h"
+
+#if (UART_RX_LEN & (UART_RX_LEN - 1)) != 0
+#error "UART_RX_LEN must be a power of 2"
+#endif
+
+// DMA1 channel 5 is wired to the USART1 receive request
+#define RX_DMA_CH		DMA1_Channel5
+#define RX_DMA_IRQn		DMA1_Channel5_IRQn
+
+// BASEPRI that masks every interrupt but the priority-0 ones, the next level down
+#define RX_MASK_PRIO	(1UL << (8 - __NVIC_PRIO_BITS))
+
+// signal the interrupts set on the waiting reader, the transmit ring uses 0x01
+#define UART_RX_SIGNAL	0x02
+// unread characters closer than this to being overwritten are given up on,
+// the DMA can keep writing while they're copied out
+#define UART_RX_MARGIN	(UART_RX_LEN / 8)
+
+// characters written by the DMA, wrapping around
+static char ring[UART_RX_LEN];
+// total characters received as of the last catch up with the DMA
+static volatile uint32_t head = 0;
+// DMA write position at the last catch up
+static uint32_t lastPos = 0;
+// total characters read, only written by the reader
+static volatile uint32_t tail = 0;
+// thread waiting for a character, NULL if none
+static osThreadId volatile waiter = NULL;
+
+void uart_rx_init(void)
+{
+	// enable the DMA1 clock
+	RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+
+	// copy every received character into the ring, wrapping around forever
+	// interrupt at the middle and end of the ring so a long burst can't lap the last catch up
+	RX_DMA_CH->CCR = 0;
+	RX_DMA_CH->CPAR = (uint32_t)&USART1->DR;
+	RX_DMA_CH->CMAR = (uint32_t)ring;
+	RX_DMA_CH->CNDTR = UART_RX_LEN;
+	RX_DMA_CH->CCR = DMA_CCR1_PL_0 | DMA_CCR1_MINC | DMA_CCR1_CIRC
+		| DMA_CCR1_HTIE | DMA_CCR1_TCIE | DMA_CCR1_EN;
+
+	// both interrupts share a priority, so they never interrupt each other's catch up
+	NVIC->ICPR[RX_DMA_IRQn/32] = 1UL << (RX_DMA_IRQn%32);	// clear any previous pending interrupt flag
+	NVIC->IP[RX_DMA_IRQn] = 0x80;		// set priority to 0x80
+	NVIC->ISER[RX_DMA_IRQn/32] = 1UL << (RX_DMA_IRQn%32);	// set interrupt enable bit
+	NVIC->ICPR[USART1_IRQn/32] = 1UL << (USART1_IRQn%32);	// clear any previous pending interrupt flag
+	NVIC->IP[USART1_IRQn] = 0x80;		// set priority to 0x80
+	NVIC->ISER[USART1_IRQn/32] = 1UL << (USART1_IRQn%32);	// set interrupt enable bit
+
+	// let RXNE request the DMA, and interrupt when the line goes idle after a burst
+	USART1->CR3 |= USART_CR3_DMAR;
+	USART1->CR1 |= USART_CR1_IDLEIE;
+}
+
+/**
+ * Counts the characters the DMA has written since the last catch up.
+ * Only called with the receive interrupts held off. Returns the number counted.
+ */
+static uint32_t catch_up(void)
+{
+	// CNDTR counts down from the ring length and reloads when the DMA wraps
+	uint32_t const pos = (UART_RX_LEN - RX_DMA_CH->CNDTR) & (UART_RX_LEN - 1);
+	// the half and full ring interrupts make sure the DMA never gets a whole lap ahead
+	uint32_t const received = (pos - lastPos) & (UART_RX_LEN - 1);
+	lastPos = pos;
+	head += received;
+	return received;
+}
+
+/** Catches up with the DMA from an interrupt and wakes the reader if anything arrived. */
+static inline void receive_irq(void)
+{
+	uint32_t const received = catch_up();
+	if (received == 0) {
+		return;
+	}
+	trace_event(TRACE_UART_RX, ring[(lastPos - 1) & (UART_RX_LEN - 1)], received);
+
+	osThreadId const thread = waiter;
+	if (thread != NULL) {
+		waiter = NULL;
+		osSignalSet(thread, UART_RX_SIGNAL);
+	}
+}
+
+uint16_t uart_rx_read(char *data, uint16_t len)
+{
+	// count what the DMA wrote since the last interrupt, which can't run in between
+	// only mask down to just below priority 0, the stream refill never touches the ring
+	// and must not be held off
+	__set_BASEPRI(RX_MASK_PRIO);
+	catch_up();
+	__set_BASEPRI(0);
+
+	uint32_t const end = head;
+	uint32_t start = tail;
+	uint32_t unread = end - start;
+	if (unread > UART_RX_LEN - UART_RX_MARGIN) {
+		// the oldest characters are being overwritten, skip to the ones that are safe to copy
+		metrics_add(METRIC_UART_RX_DROPS, unread - (UART_RX_LEN - UART_RX_MARGIN));
+		unread = UART_RX_LEN - UART_RX_MARGIN;
+		start = end - unread;
+	}
+	metrics_gauge_set(METRIC_UART_RX_DEPTH, unread);
+
+	if (len > unread) {
+		len = unread;
+	}
+	for (uint16_t i = 0; i < len; ++i) {
+		data[i] = ring[(start + i) & (UART_RX_LEN - 1)];
+	}
+	tail = start + len;
+	return len;
+}
+
+char uart_rx_getc(void)
+{
+	char c;
+	while (uart_rx_read(&c, 1) == 0) {
+		osThreadId const self = osThreadGetId();
+		// drop a wakeup left over from a character that was already read
+		osSignalClear(self, UART_RX_SIGNAL);
+		waiter = self;
+		// a character may have landed before the interrupt saw the waiter, don't sleep through it
+		if (head == tail) {
+			osSignalWait(UART_RX_SIGNAL, osWaitForever);
+		}
+		waiter = NULL;
+	}
+	return c;
+}
+
+/*-----------------------------------------------------------------------------
+	DMA1 Channel 5 IRQ Handler
+		Half transfer / transfer complete: the DMA passed the middle or end of the ring
+ *---------------------------------------------------------------------------*/
+void DMA1_Channel5_IRQHandler(void)
+{
+	uint32_t const start = profile_now();
+	DMA1->IFCR = DMA_IFCR_CGIF5;
+	receive_irq();
+	profile_end(PROFILE_UART_IRQ, start);
+}
+
+/*-----------------------------------------------------------------------------
+	USART1 IRQ Handler
+		Idle line: a burst just ended, hand what arrived to the UART thread
+		Reading SR then DR clears the idle and overrun flags
+ *---------------------------------------------------------------------------*/
+void USART1_IRQHandler(void)
+{
+	uint32_t const start = profile_now();
+	uint32_t const status = USART1->SR;
+	if (status & (USART_SR_IDLE | USART_SR_ORE)) {
+		// the DMA empties DR within a few cycles of RXNE, so this read finds nothing to steal
+		(void)USART1->DR;
+		// an overrun means a character arrived before the DMA took the last one
+		if (status & USART_SR_ORE) {
+			metrics_inc(METRIC_UART_OVERRUNS);
+		}
+	}
+	receive_irq();
+	profile_end(PROFILE_UART_IRQ, start);
+}
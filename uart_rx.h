@@ -0,0 +1,31 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * DMA driven USART1 receive ring.
+ * DMA1 channel 5 copies every received character into a circular buffer with no CPU
+ * involvement. The UART thread is woken when the line goes idle at the end of a burst,
+ * or when the DMA passes the middle or end of the ring during a long one, so a pasted
+ * script costs a few interrupts instead of one interrupt and kernel call per character.
+ * The ring has one reader, the UART thread.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/** Number of characters the ring holds, a power of 2. */
+#define UART_RX_LEN	512
+
+/** Initialize the receive DMA channel and start receiving, after USART1 is set up. */
+void uart_rx_init(void);
+/**
+ * Reads up to len received characters without waiting.
+ * Returns the number read. Characters the reader fell too far behind to keep
+ * are skipped and counted as UART RX drops.
+ */
+uint16_t uart_rx_read(char *data, uint16_t len);
+/** Reads the next received character, waiting until there is one. */
+char uart_rx_getc(void);
@@ -0,0 +1,158 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "uart_tx.h"
+#include "global.h"
+#include "metrics.h"
+#include "profile.h"
+
+#if (UART_TX_LEN & (UART_TX_LEN - 1)) != 0
+#error "UART_TX_LEN must be a power of 2"
+#endif
+
+// DMA1 channel 4 is wired to the USART1 transmit request
+#define TX_DMA_CH		DMA1_Channel4
+#define TX_DMA_IRQn		DMA1_Channel4_IRQn
+
+// signal the interrupt sets on a waiting sender once few enough characters are left queued
+#define UART_TX_SIGNAL	0x01
+// longest run, the ring is only freed as runs complete, so a full ring frees half of it while
+// the other half is still being sent and the sender can refill it before the line goes idle
+#define UART_TX_RUN		(UART_TX_LEN / 2)
+
+// characters waiting to be sent, head and tail count up and wrap around the ring
+static char ring[UART_TX_LEN];
+// total characters queued, only written by the sender
+static volatile uint32_t head = 0;
+// total characters sent, only written by the interrupt
+static volatile uint32_t tail = 0;
+// characters in the transfer in progress, 0 when the DMA is idle
+static volatile uint16_t dmaLen = 0;
+// thread waiting for room in the ring or for it to drain, NULL if none
+static osThreadId volatile waiter = NULL;
+// most characters left queued that wake the waiter, half the ring for room, 0 for a flush
+static volatile uint32_t wakeQueued = 0;
+
+void uart_tx_init(void)
+{
+	// enable the DMA1 clock
+	RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+
+	// each transfer copies a run of the ring to the data register, one byte per TXE
+	TX_DMA_CH->CCR = 0;
+	TX_DMA_CH->CPAR = (uint32_t)&USART1->DR;
+	// let TXE request the DMA
+	USART1->CR3 |= USART_CR3_DMAT;
+
+	// the transfer complete interrupt starts the next run, same priority as the receive interrupt
+	NVIC->ICPR[TX_DMA_IRQn/32] = 1UL << (TX_DMA_IRQn%32);	// clear any previous pending interrupt flag
+	NVIC->IP[TX_DMA_IRQn] = 0x80;		// set priority to 0x80
+	NVIC->ISER[TX_DMA_IRQn/32] = 1UL << (TX_DMA_IRQn%32);	// set interrupt enable bit
+}
+
+uint16_t uart_tx_write(char const *data, uint16_t len)
+{
+	uint32_t const start = head;
+	uint32_t const space = UART_TX_LEN - (start - tail);
+	if (len > space) {
+		len = space;
+	}
+	if (len == 0) {
+		return 0;
+	}
+
+	for (uint16_t i = 0; i < len; ++i) {
+		ring[(start + i) & (UART_TX_LEN - 1)] = data[i];
+	}
+	// the characters have to be in the ring before the interrupt can see them
+	__DMB();
+	head = start + len;
+
+	// only the interrupt starts transfers, pend it in case the DMA is idle
+	NVIC->ISPR[TX_DMA_IRQn/32] = 1UL << (TX_DMA_IRQn%32);
+	return len;
+}
+
+/** Sleeps until the interrupt sees at most most characters left queued. */
+static void wait_queued(uint32_t most)
+{
+	osThreadId const self = osThreadGetId();
+	// drop a wakeup left over from a wait that didn't need to sleep
+	osSignalClear(self, UART_TX_SIGNAL);
+	wakeQueued = most;
+	waiter = self;
+	// the interrupt may have sent enough before it saw the waiter, don't sleep through that
+	if (head - tail > most) {
+		osSignalWait(UART_TX_SIGNAL, osWaitForever);
+	}
+	waiter = NULL;
+}
+
+void uart_tx_send(char const *data, uint16_t len)
+{
+	while (1) {
+		uint16_t const queued = uart_tx_write(data, len);
+		data += queued;
+		len -= queued;
+		if (len == 0) {
+			return;
+		}
+
+		// the ring is full, sleep until the DMA has sent half of it
+		uint32_t const start = profile_now();
+		wait_queued(UART_TX_LEN / 2);
+		metrics_inc(METRIC_UART_TX_STALLS);
+		metrics_add(METRIC_UART_TX_STALL_US, (profile_now() - start) / (SystemCoreClock / 1000000));
+	}
+}
+
+void uart_tx_flush(void)
+{
+	// only this thread writes, so nothing is queued behind what's there now
+	wait_queued(0);
+}
+
+/*-----------------------------------------------------------------------------
+	DMA1 Channel 4 IRQ Handler
+		Transfer complete: the run in progress was sent, free it from the ring
+		Pended by a write: start a run if the DMA is idle
+ *---------------------------------------------------------------------------*/
+void DMA1_Channel4_IRQHandler(void)
+{
+	if (DMA1->ISR & DMA_ISR_TCIF4) {
+		DMA1->IFCR = DMA_IFCR_CGIF4;
+		TX_DMA_CH->CCR = 0;
+		tail += dmaLen;
+		dmaLen = 0;
+	}
+	if (dmaLen != 0) {
+		// still sending, the transfer complete interrupt picks up the rest
+		return;
+	}
+
+	uint32_t const next = tail;
+	uint32_t const queued = head - next;
+	if (queued != 0) {
+		// send up to the end of the ring, the rest wraps around to the next run
+		uint32_t const offset = next & (UART_TX_LEN - 1);
+		uint32_t len = (queued < UART_TX_LEN - offset) ? queued : UART_TX_LEN - offset;
+		if (len > UART_TX_RUN) {
+			len = UART_TX_RUN;
+		}
+		dmaLen = len;
+		TX_DMA_CH->CMAR = (uint32_t)&ring[offset];
+		TX_DMA_CH->CNDTR = len;
+		TX_DMA_CH->CCR = DMA_CCR1_MINC | DMA_CCR1_DIR | DMA_CCR1_TCIE | DMA_CCR1_EN;
+	}
+
+	// wake a sender once there's room for a good chunk, not for every run, or a flush once it's all sent
+	osThreadId const thread = waiter;
+	if (thread != NULL && queued <= wakeQueued) {
+		waiter = NULL;
+		osSignalSet(thread, UART_TX_SIGNAL);
+	}
+}
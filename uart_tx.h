@@ -0,0 +1,39 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * DMA driven USART1 transmit ring.
+ * Text is copied into the ring and DMA1 channel 4 sends it to USART1 in runs of up to
+ * half the ring, so a whole menu goes out at full line rate without the CPU touching
+ * each character. The sending thread only waits, on an RTOS signal, when the ring is full
+ * or when it flushes the ring to know its text has been sent.
+ * The ring has one writer, the UART thread. Only the DMA interrupt starts transfers,
+ * a write pends it to start one if the DMA is idle.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/** Number of characters the ring holds, a power of 2. */
+#define UART_TX_LEN	256
+
+/** Initialize the transmit DMA channel, after USART1 is set up. */
+void uart_tx_init(void);
+/**
+ * Queues up to len characters without waiting.
+ * Returns the number queued, fewer than len if the ring filled up.
+ */
+uint16_t uart_tx_write(char const *data, uint16_t len);
+/**
+ * Queues len characters, waiting while the ring is full.
+ * The time spent waiting is recorded in the UART TX stall metrics.
+ */
+void uart_tx_send(char const *data, uint16_t len);
+/**
+ * Waits until everything queued has been handed to USART1, woken by the DMA interrupt.
+ * The last character may still be shifting out on the line when it returns.
+ */
+void uart_tx_flush(void);
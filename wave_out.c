@@ -0,0 +1,346 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "wave_out.h"
+#include "global.h"
+#include "metrics.h"
+#include "profile.h"
+#include "snapshot.h"
+#include "trace.h"
+
+// samples streamed to the waveform port
+static uint16_t wave_out_buf[WAVE_OUT_BUF_LEN];
+
+// TIM2 and DMA1 channel 2 are dedicated to the output engine
+#define OUT_TIM		TIM2
+#define OUT_DMA_CH	DMA1_Channel2
+#define OUT_DMA_IRQn	DMA1_Channel2_IRQn
+
+// the timer can only count 0x10000 ticks between samples, which limits the time the buffer can loop
+#define MAX_TABLE_TICKS	(0x10000ull * WAVE_OUT_BUF_LEN)
+// timer clocks in 1000 seconds, the same scale as frequencies in mHz
+#define TIM_CLK_X1000	(TIM_CLK_HZ * 1000ull)
+
+// 16-bit samples are zero-extended into the 32-bit ODR, looping over the buffer
+#define OUT_DMA_CCR		(DMA_CCR1_PL_1 | DMA_CCR1_MSIZE_0 | DMA_CCR1_PSIZE_1 \
+		| DMA_CCR1_MINC | DMA_CCR1_CIRC | DMA_CCR1_DIR)
+
+// published state of the waveform playing, NULL when stopped
+static snapshot_t const *owner = NULL;
+// waveform being streamed, NULL when looping a period or stopped
+static wave_out_run_t streamRun = NULL;
+// rate the waveform is being streamed at
+static uint32_t streamRateHz = 0;
+// published state of the waveform being streamed
+static snapshot_t const *streamSnap = NULL;
+// copy of the waveform state used by the refill, only used from the DMA interrupt while streaming
+static uint32_t streamState[SNAPSHOT_MAX_SZ / 4];
+
+// refill timing, written by the DMA interrupt while streaming
+// cycles between two refills when they are serviced on time
+static uint32_t refillPeriodCycles = 0;
+// cycle counter at the last refill, 0 before the first one
+static volatile uint32_t lastRefillCycles = 0;
+// worst early or late refill, in cycles
+static volatile uint32_t refillJitterCycles = 0;
+// fewest samples left to play before the DMA reached a half that was being refilled
+static volatile uint16_t refillSlack = 0;
+// refills that interrupted a publish, so they ran on the state from before it
+static volatile uint32_t refillStaleReads = 0;
+
+// status for the UI, only written by the thread driving the output
+static wave_out_status_t status = {
+	.mode = WAVE_OUT_STOPPED,
+};
+
+void wave_out_init(void)
+{
+	// enable the DMA1 and TIM2 clocks
+	RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+	RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+
+	// count at the full timer clock, buffer ARR so a new rate starts on an update
+	OUT_TIM->CR1 = TIM_CR1_ARPE;
+	OUT_TIM->PSC = 0;
+	// every update event requests one DMA transfer
+	OUT_TIM->DIER = TIM_DIER_UDE;
+
+	// DMA copies from the buffer to the port output register
+	OUT_DMA_CH->CCR = 0;
+	OUT_DMA_CH->CPAR = (uint32_t)&WAVEFORM_PORT->ODR;
+	OUT_DMA_CH->CMAR = (uint32_t)wave_out_buf;
+
+	// the stream refill has to beat the DMA back to the half it's refilling,
+	// so nothing can hold it off, it never calls the RTOS so it can run above everything
+	NVIC->ICPR[OUT_DMA_IRQn/32] = 1UL << (OUT_DMA_IRQn%32);	// clear any previous pending interrupt flag
+	NVIC->IP[OUT_DMA_IRQn] = 0x00;		// set priority to 0x00, the highest
+	NVIC->ISER[OUT_DMA_IRQn/32] = 1UL << (OUT_DMA_IRQn%32);	// set interrupt enable bit
+}
+
+/** Layout of a table that loops a whole number of periods. */
+typedef struct _table_t {
+	/** Number of samples in the table */
+	uint16_t len;
+	/** Number of periods the table holds */
+	uint16_t periods;
+	/** Timer clocks between samples */
+	uint32_t sampleTicks;
+} table_t;
+
+/** Greatest common divisor of a and b. */
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t const r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+/**
+ * Lays out a table that loops the frequency exactly, at up to rateHz samples per second.
+ * Returns 0 if the frequency can't be looped from the output buffer.
+ */
+static uint8_t plan_table(table_t *table, uint32_t freqMhz, uint32_t rateHz)
+{
+	// a 0 frequency is a constant output, nothing to loop
+	if (freqMhz == 0) {
+		return 0;
+	}
+
+	// the table has to loop in a whole number of timer clocks, so it holds the fewest
+	// whole periods that do, periods * TIM_CLK_X1000 / freqMhz
+	uint32_t const divisor = gcd(freqMhz, TIM_CLK_X1000 % freqMhz);
+	uint32_t const periods = freqMhz / divisor;
+	uint64_t const ticks64 = TIM_CLK_X1000 / divisor;
+	// too many periods or too long a period to fit, nothing to loop
+	if (periods > 0xFFFF || ticks64 > MAX_TABLE_TICKS) {
+		return 0;
+	}
+	uint32_t const ticks = ticks64;
+
+	// fewest samples that keep the sample time within the timer range
+	uint32_t const minLen = (ticks + 0xFFFF) >> 16;
+
+	// use as many samples as fit in the buffer without exceeding the sample rate
+	uint32_t len = (uint64_t)ticks * rateHz / TIM_CLK_HZ;
+	if (len > WAVE_OUT_BUF_LEN) {
+		len = WAVE_OUT_BUF_LEN;
+	}
+	// the sample time has to be a whole number of ticks so the table loops exactly
+	// this only runs when the waveform changes, and tries at most a buffer's worth of lengths
+	while (len >= minLen && ticks % len != 0) {
+		--len;
+	}
+	if (len < minLen) {
+		return 0;
+	}
+
+	table->len = len;
+	table->periods = periods;
+	table->sampleTicks = ticks / len;
+	return 1;
+}
+
+/** Starts DMA over the first len samples of the buffer, one sample every ticks timer clocks. */
+static void start_dma(uint16_t len, uint32_t ticks, uint32_t irqFlags)
+{
+	OUT_DMA_CH->CNDTR = len;
+	OUT_DMA_CH->CCR = OUT_DMA_CCR | irqFlags | DMA_CCR1_EN;
+
+	// slow rates count more ticks than ARR holds, prescale them
+	// every selectable rate divides the timer clock, so this stays exact
+	uint32_t const prescaler = (ticks - 1) >> 16;
+	OUT_TIM->PSC = prescaler;
+	OUT_TIM->ARR = ticks / (prescaler + 1) - 1;
+	OUT_TIM->CNT = 0;
+	// load the new rate, this update also outputs the first sample
+	OUT_TIM->EGR = TIM_EGR_UG;
+	OUT_TIM->CR1 |= TIM_CR1_CEN;
+}
+
+/** Stops whatever is playing. */
+static void stop_output(void)
+{
+	OUT_TIM->CR1 &= ~TIM_CR1_CEN;
+	OUT_DMA_CH->CCR &= ~(DMA_CCR1_EN | DMA_CCR1_HTIE | DMA_CCR1_TCIE);
+	// drop any refill that was already requested
+	DMA1->IFCR = DMA_IFCR_CGIF2;
+	NVIC->ICPR[OUT_DMA_IRQn/32] = 1UL << (OUT_DMA_IRQn%32);
+	streamRun = NULL;
+	owner = NULL;
+	if (status.mode != WAVE_OUT_STOPPED) {
+		trace_event(TRACE_OUT_STOP, 0, 0);
+	}
+	status.mode = WAVE_OUT_STOPPED;
+}
+
+/** Renders whole periods into the buffer and loops them. */
+static void start_table(wave_out_render_t render, snapshot_t const *state, table_t const *table)
+{
+	uint32_t tableState[SNAPSHOT_MAX_SZ / 4];
+	snapshot_read(state, tableState);
+
+	// stop the output in progress so the old and new tables don't mix
+	stop_output();
+
+	// the amplitude is baked into the table, so playback is just DMA
+	uint32_t const start = profile_now();
+	render(tableState, wave_out_buf, table->len, table->periods);
+	metrics_add(METRIC_SAMPLES, table->len);
+	status.renderUs = (profile_now() - start) / (SystemCoreClock / 1000000);
+	profile_end(PROFILE_TABLE_RENDER, start);
+
+	// no interrupts needed to loop
+	start_dma(table->len, table->sampleTicks, 0);
+
+	status.mode = WAVE_OUT_TABLE;
+	status.len = table->len;
+	status.periods = table->periods;
+	status.rateHz = TIM_CLK_HZ / table->sampleTicks;
+	trace_event(TRACE_OUT_TABLE, table->periods, table->len);
+}
+
+/** Starts generating a waveform half a buffer at a time while it streams. */
+static void start_stream(wave_out_run_t run, snapshot_t const *state, uint32_t rateHz)
+{
+	if (run == streamRun && rateHz == streamRateHz) {
+		// already streaming, the refill picks up the new state at the next half boundary
+		return;
+	}
+
+	// stop any output in progress before reprogramming
+	stop_output();
+
+	snapshot_read(state, streamState);
+	streamSnap = state;
+	streamRun = run;
+	streamRateHz = rateHz;
+
+	// start the refill timing over at the new rate, the core and timer clocks are the same
+	refillPeriodCycles = WAVE_OUT_STREAM_HALF_LEN * (TIM_CLK_HZ / rateHz);
+	lastRefillCycles = 0;
+	refillJitterCycles = 0;
+	refillSlack = WAVE_OUT_STREAM_HALF_LEN;
+	refillStaleReads = 0;
+
+	// fill both halves before starting, then refill each half as it finishes
+	run(streamState, wave_out_buf, 2 * WAVE_OUT_STREAM_HALF_LEN);
+	metrics_add(METRIC_SAMPLES, 2 * WAVE_OUT_STREAM_HALF_LEN);
+	start_dma(2 * WAVE_OUT_STREAM_HALF_LEN, TIM_CLK_HZ / rateHz, DMA_CCR1_HTIE | DMA_CCR1_TCIE);
+
+	status.mode = WAVE_OUT_STREAM;
+	status.len = 2 * WAVE_OUT_STREAM_HALF_LEN;
+	status.periods = 0;
+	status.rateHz = rateHz;
+	trace_event(TRACE_OUT_STREAM, 0, status.len);
+}
+
+void wave_out_play(wave_out_render_t render, wave_out_run_t run, snapshot_t const *state,
+	uint32_t freqMhz, uint32_t rateHz)
+{
+	table_t table;
+	if (plan_table(&table, freqMhz, rateHz)) {
+		start_table(render, state, &table);
+	} else {
+		// the periods don't fit in the buffer, fall back to generating them live
+		start_stream(run, state, rateHz);
+	}
+	owner = state;
+}
+
+uint8_t wave_out_stop(snapshot_t const *state)
+{
+	// a waveform that isn't playing leaves the one that is alone
+	if (state != owner) {
+		return 0;
+	}
+	stop_output();
+	return 1;
+}
+
+void wave_out_get_status(wave_out_status_t *out)
+{
+	*out = status;
+	if (status.mode == WAVE_OUT_STREAM) {
+		out->refillJitterCycles = refillJitterCycles;
+		out->refillSlack = refillSlack;
+		out->refillStaleReads = refillStaleReads;
+	}
+}
+
+/** Records how far a refill landed from when it was due. */
+static inline void time_refill(void)
+{
+	uint32_t const now = profile_now();
+	if (lastRefillCycles) {
+		uint32_t const elapsed = now - lastRefillCycles;
+		uint32_t const jitter = (elapsed > refillPeriodCycles)
+			? elapsed - refillPeriodCycles : refillPeriodCycles - elapsed;
+		if (jitter > refillJitterCycles) {
+			refillJitterCycles = jitter;
+		}
+	}
+	// 0 marks no refill yet, a count of exactly 0 just skips one measurement
+	lastRefillCycles = now;
+}
+
+/** Records the samples left before the DMA reaches the half that was just refilled. */
+static inline void check_slack(uint16_t left)
+{
+	if (left < refillSlack) {
+		refillSlack = left;
+	}
+}
+
+/** Refills one half of the stream buffer from the current waveform state. */
+static inline void refill(uint16_t *half)
+{
+	// take the latest state on a half-buffer boundary, a change never lands in the middle of a half
+	trace_event(TRACE_REFILL_ENTER, half != wave_out_buf, 0);
+	// this interrupt always preempts the writer, so the read never retries, but if it
+	// interrupted a publish it gets the state from before it and the change waits one more half
+	uint8_t const bStale = snapshot_publishing(streamSnap);
+	if (bStale) {
+		++refillStaleReads;
+	}
+	snapshot_read(streamSnap, streamState);
+	uint32_t const start = profile_now();
+	streamRun(streamState, half, WAVE_OUT_STREAM_HALF_LEN);
+	profile_end(PROFILE_STREAM_REFILL, start);
+	metrics_inc(METRIC_REFILLS);
+	metrics_add(METRIC_SAMPLES, WAVE_OUT_STREAM_HALF_LEN);
+	trace_event(TRACE_REFILL_EXIT, bStale, half[0]);
+}
+
+/*-----------------------------------------------------------------------------
+	DMA1 Channel 2 IRQ Handler
+		Half transfer: the first half finished playing, refill it
+		Transfer complete: the second half finished playing, refill it
+ *---------------------------------------------------------------------------*/
+void DMA1_Channel2_IRQHandler(void)
+{
+	uint32_t const flags = DMA1->ISR;
+	time_refill();
+
+	if (flags & DMA_ISR_HTIF2) {
+		DMA1->IFCR = DMA_IFCR_CHTIF2;
+		refill(&wave_out_buf[0]);
+		// the DMA is playing the second half, then wraps to the first
+		// if it's wrapped already, the refill landed with nothing left
+		uint16_t const left = OUT_DMA_CH->CNDTR;
+		check_slack(left <= WAVE_OUT_STREAM_HALF_LEN ? left : 0);
+	}
+	if (flags & DMA_ISR_TCIF2) {
+		DMA1->IFCR = DMA_IFCR_CTCIF2;
+		refill(&wave_out_buf[WAVE_OUT_STREAM_HALF_LEN]);
+		// the DMA is playing the first half, then moves on to the second
+		uint16_t const left = OUT_DMA_CH->CNDTR;
+		check_slack(left > WAVE_OUT_STREAM_HALF_LEN ? left - WAVE_OUT_STREAM_HALF_LEN : 0);
+	}
+}
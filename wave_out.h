@@ -0,0 +1,96 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * DMA output engine for the waveform port.
+ * TIM2 update events request DMA1 channel 2, which copies the next sample
+ * from wave_out_buf to the waveform port without any CPU involvement.
+ *
+ * Samples are output at a selectable rate, timed by TIM2 independently of the RTOS tick.
+ * When a whole number of periods fits in the buffer at that rate and loops in a
+ * whole number of timer clocks, they are rendered once and looped.
+ * Otherwise the waveform is streamed: the first 2 * WAVE_OUT_STREAM_HALF_LEN samples
+ * are split into two halves, and the half that just finished playing is
+ * refilled by the waveform from the DMA half/full transfer interrupts.
+ */
+
+#pragma once
+
+#include "global.h"
+#include "snapshot.h"
+
+/** Max number of samples in the output buffer. */
+#define WAVE_OUT_BUF_LEN		1024
+/** Min rate samples can be output to the waveform port. */
+#define WAVE_OUT_MIN_RATE_HZ	1000
+/** Max rate samples can be output to the waveform port. */
+#define WAVE_OUT_MAX_RATE_HZ	500000
+/** Sample rate the waveforms start with. */
+#define WAVE_OUT_DEFAULT_RATE_HZ	10000
+/**
+ * Number of samples in each half of the stream buffer.
+ * A half has to be refilled while the other half plays, so at the max
+ * sample rate the refill deadline is 128 / 500 kHz = 256 us.
+ */
+#define WAVE_OUT_STREAM_HALF_LEN	128
+
+/**
+ * Generates the next len samples of a waveform into buf from a copy of its published state.
+ * A run continues the waveform where the last run left off, and is called from the DMA interrupt.
+ */
+typedef void (*wave_out_run_t)(void const *state, uint16_t *buf, uint16_t len);
+/**
+ * Renders exactly periods periods of a waveform from its start into the len samples of buf,
+ * from a copy of its published state. Called from the waveform thread.
+ */
+typedef void (*wave_out_render_t)(void const *state, uint16_t *buf, uint16_t len, uint16_t periods);
+
+/** What the output engine is doing. */
+typedef enum _wave_out_mode_t {
+	/** Nothing is being output */
+	WAVE_OUT_STOPPED,
+	/** One rendered period is looped from the buffer */
+	WAVE_OUT_TABLE,
+	/** Samples are generated half a buffer at a time while they stream */
+	WAVE_OUT_STREAM,
+} wave_out_mode_t;
+
+/** Status of the output engine. */
+typedef struct _wave_out_status_t {
+	/** What the engine is doing */
+	wave_out_mode_t mode;
+	/** Number of samples in the table or stream buffer */
+	uint16_t len;
+	/** Number of periods in the table */
+	uint16_t periods;
+	/** Rate samples are output */
+	uint32_t rateHz;
+	/** Time the last table rebuild took */
+	uint32_t renderUs;
+	/** Worst number of core cycles a stream refill ran early or late */
+	uint32_t refillJitterCycles;
+	/** Fewest samples left to play when a stream refill finished */
+	uint16_t refillSlack;
+	/** Number of stream refills that interrupted a config update and ran on the state from before it */
+	uint32_t refillStaleReads;
+} wave_out_status_t;
+
+/** Initialize the DMA output engine. */
+void wave_out_init(void);
+/**
+ * Starts or updates the output of a waveform from its published state, at up to rateHz samples per second.
+ * If whole periods of freqMhz fit in the output buffer they are rendered once and looped,
+ * otherwise the waveform is generated with run while it streams at exactly rateHz.
+ * A waveform that is already streaming at the same rate picks up the new state at its next half buffer.
+ */
+void wave_out_play(wave_out_render_t render, wave_out_run_t run, snapshot_t const *state,
+	uint32_t freqMhz, uint32_t rateHz);
+/**
+ * Stops the output if it's playing the waveform published in state, leaving the waveform port at its last value.
+ * Returns non-zero if it was, 0 if another waveform or nothing is playing and was left alone.
+ */
+uint8_t wave_out_stop(snapshot_t const *state);
+/** Reads the status of the output engine. */
+void wave_out_get_status(wave_out_status_t *status);
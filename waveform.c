@@ -0,0 +1,129 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ */
+
+#include "waveform.h"
+#include "global.h"
+#include "profile.h"
+#include "pwm_wave.h"
+#include "sawtooth_wave.h"
+#include "sine_wave.h"
+#include "snapshot.h"
+#include "stack_watch.h"
+#include "trace.h"
+#include "triangle_wave.h"
+
+/** A waveform owned by the manager. */
+typedef struct _waveform_entry_t {
+	/** Operations on the waveform */
+	waveform_ops_t const *ops;
+	/** Profiler probe for applying its config params */
+	profile_probe_t probe;
+} waveform_entry_t;
+
+// the waveforms, in the order of waveform_id_t
+static waveform_entry_t const waveforms[WAVEFORM_NUM] = {
+	[WAVEFORM_PWM] = { &pwm_wave_ops, PROFILE_PWM_CFG },
+	[WAVEFORM_SAWTOOTH] = { &sawtooth_wave_ops, PROFILE_SAWTOOTH_CFG },
+	[WAVEFORM_SINE] = { &sine_wave_ops, PROFILE_SINE_CFG },
+	[WAVEFORM_TRIANGLE] = { &triangle_wave_ops, PROFILE_TRIANGLE_CFG },
+};
+
+// published config of each waveform, only written by the manager thread
+static snapshot_t statusSnaps[WAVEFORM_NUM];
+SNAPSHOT_CHECK_SIZE(waveform_status_t);
+
+// mail queue of configuration parameters to apply
+static osMailQDef(waveform_cfg_q, 0x8, waveform_msg_t);
+osMailQId Q_waveform_cfg_id;
+
+/** Publishes the config of a waveform for waveform_get_status. */
+static void publish_status(waveform_id_t wave)
+{
+	waveform_ops_t const *ops = waveforms[wave].ops;
+	waveform_status_t const status = {
+		.freqMhz = ops->get(PARAM_FREQ_MHZ),
+		.sampleRateHz = ops->get(PARAM_SAMPLE_RATE),
+		.amplitude = ops->get(PARAM_AMPLITUDE),
+		.dutyCycle = ops->get(PARAM_DUTYCYCLE),
+		.bEnabled = ops->get(PARAM_ENABLE),
+	};
+	snapshot_publish(&statusSnaps[wave], &status, sizeof(status));
+}
+
+void waveform_init(void)
+{
+	// create the mailbox
+	Q_waveform_cfg_id = osMailCreate(osMailQ(waveform_cfg_q), NULL);
+
+	// set up each waveform and publish its initial config
+	for (waveform_id_t wave = 0; wave < WAVEFORM_NUM; ++wave) {
+		waveforms[wave].ops->init();
+		publish_status(wave);
+	}
+}
+
+/**
+ * Disables every waveform but wave if the batch is going to enable it.
+ * They all share the waveform port, so only one is ever enabled, the same as switching waveforms in the menus.
+ */
+static void disable_others(waveform_id_t wave, waveform_batch_t const *batch)
+{
+	uint32_t value;
+	// a non-zero enable toggles, so it only turns on a waveform that's off
+	if (!waveform_batch_get(batch, PARAM_ENABLE, &value) || value == 0
+		|| waveforms[wave].ops->get(PARAM_ENABLE)) {
+		return;
+	}
+
+	waveform_batch_t off = {0};
+	waveform_cfg_t const cfg = {
+		.type = PARAM_ENABLE,
+		.value = 0,
+	};
+	waveform_batch_add(&off, cfg);
+	for (waveform_id_t other = 0; other < WAVEFORM_NUM; ++other) {
+		if (other != wave && waveforms[other].ops->get(PARAM_ENABLE)) {
+			waveforms[other].ops->set(&off);
+			publish_status(other);
+		}
+	}
+}
+
+void waveform_thread(void const *arg)
+{
+	// find the bottom of this thread's stack for the high-water mark
+	stack_watch_register(STACK_WATCH_WAVEFORM);
+
+	osEvent retval;
+	while (1) {
+		// wait for a new config param
+		retval = osMailGet(Q_waveform_cfg_id, osWaitForever);
+		if (retval.status == osEventMail) {
+			waveform_msg_t *msg = retval.value.p;
+			metrics_gauge_down(METRIC_CFG_Q_DEPTH);
+
+			if (msg->wave < WAVEFORM_NUM) {
+				waveform_entry_t const *entry = &waveforms[msg->wave];
+				uint32_t const start = profile_now();
+				trace_event(TRACE_CFG_GET, msg->wave, msg->batch.mask);
+
+				disable_others(msg->wave, &msg->batch);
+				entry->ops->set(&msg->batch);
+				publish_status(msg->wave);
+				profile_end(entry->probe, start);
+				trace_event(TRACE_CFG_DONE, msg->wave, 0);
+				metrics_inc(METRIC_CFG_APPLIED);
+			}
+			osMailFree(Q_waveform_cfg_id, msg);
+		}
+	}
+}
+
+void waveform_get_status(waveform_id_t wave, waveform_status_t *status)
+{
+	snapshot_read(&statusSnaps[wave], status);
+}
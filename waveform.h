@@ -0,0 +1,98 @@
+/*
+ * CE 426 - Real-Time Embedded Systems
+ * Instructor: Dr. Tewolde
+ * Author: Benjamin Hall
+ * Final Project: Function Generator
+ *
+ * Waveform manager.
+ * One thread owns every waveform and applies the config params sent to any of them,
+ * dispatching each one through the waveform's table of operations.
+ * Params sent in one batch are applied together with a single output update,
+ * so the output never runs with a mix of their old and new values.
+ * The waveforms share one output port, so enabling one disables the others first.
+ * After every change the waveform's config is published as a lock-free snapshot,
+ * so reading it back is a copy instead of a round trip through the thread.
+ */
+
+#pragma once
+
+#include "global.h"
+#include "metrics.h"
+#include "trace.h"
+#include "waveform_cfg.h"
+
+/** The waveforms owned by the manager. */
+typedef enum _waveform_id_t {
+	WAVEFORM_PWM,
+	WAVEFORM_SAWTOOTH,
+	WAVEFORM_SINE,
+	WAVEFORM_TRIANGLE,
+
+	WAVEFORM_NUM,
+} waveform_id_t;
+
+/** Operations on one waveform, only called from the manager thread. */
+typedef struct _waveform_ops_t {
+	/** Calculates the values that depend on the initial config */
+	void (*init)(void);
+	/** Applies a batch of config params, updating the output once if it's running */
+	void (*set)(waveform_batch_t const *batch);
+	/** Reads a config param in the units it was sent in */
+	uint32_t (*get)(waveform_cfg_param_t param);
+} waveform_ops_t;
+
+/** Config of a waveform in the units it was sent in. */
+typedef struct _waveform_status_t {
+	/** Frequency in mHz */
+	uint32_t freqMhz;
+	/** Sample rate, 0 if the waveform isn't sampled */
+	uint32_t sampleRateHz;
+	/** Amplitude in % */
+	uint8_t amplitude;
+	/** Duty cycle in %, 0 if the waveform has none */
+	uint8_t dutyCycle;
+	/** Non-zero if the output is enabled */
+	uint8_t bEnabled;
+} waveform_status_t;
+
+/** A batch of config params addressed to one waveform. */
+typedef struct _waveform_msg_t {
+	/** The waveform the params are for */
+	waveform_id_t wave;
+	/** The params */
+	waveform_batch_t batch;
+} waveform_msg_t;
+
+/** Initialize the waveform manager and all the waveforms. */
+void waveform_init(void);
+/** Thread to manage all the waveforms. */
+void waveform_thread(void const *arg);
+/** Reads the last published config of a waveform, never blocks on the manager thread. */
+void waveform_get_status(waveform_id_t wave, waveform_status_t *status);
+
+/** Sends a batch of configuration parameters to a waveform, they're applied together. */
+static inline osStatus waveform_send_batch(waveform_id_t wave, waveform_batch_t const *batch)
+{
+	extern osMailQId Q_waveform_cfg_id;
+	trace_event(TRACE_CFG_SEND, wave, batch->mask);
+	// alloc a message in the mailbox and copy the batch passed in
+	waveform_msg_t *msg = osMailAlloc(Q_waveform_cfg_id, osWaitForever);
+	if (msg == NULL) {
+		// only happens from an interrupt, which can't wait for a free slot
+		metrics_inc(METRIC_CFG_Q_DROPS);
+		return osErrorResource;
+	}
+	msg->wave = wave;
+	msg->batch = *batch;
+	trace_event(TRACE_CFG_PUT, wave, batch->mask);
+	metrics_gauge_up(METRIC_CFG_Q_DEPTH);
+	return osMailPut(Q_waveform_cfg_id, msg);
+}
+
+/** Sends a configuration parameter to a waveform. */
+static inline osStatus waveform_send_cfg(waveform_id_t wave, waveform_cfg_t cfg)
+{
+	waveform_batch_t batch = {0};
+	waveform_batch_add(&batch, cfg);
+	return waveform_send_batch(wave, &batch);
+}
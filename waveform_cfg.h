@@ -11,11 +11,13 @@
 
 /** Waveform configuration parameter types. */
 typedef enum _waveform_cfg_param_t {
-	PARAM_RECV,
 	PARAM_AMPLITUDE,
-	PARAM_PERIOD_MS,
+	PARAM_FREQ_MHZ,
 	PARAM_DUTYCYCLE,
+	PARAM_SAMPLE_RATE,
 	PARAM_ENABLE,
+
+	PARAM_NUM,
 } waveform_cfg_param_t;
 
 /** Represents a waveform configuration value. */
@@ -25,3 +27,29 @@ typedef struct _waveform_cfg_t {
 	/** The new value */
 	uint32_t value;
 } waveform_cfg_t;
+
+/** Any set of configuration values, applied to a waveform together. */
+typedef struct _waveform_batch_t {
+	/** Bit (1 << type) is set for each parameter in the batch */
+	uint8_t mask;
+	/** The new value of each parameter in the batch */
+	uint32_t values[PARAM_NUM];
+} waveform_batch_t;
+
+/** Adds a configuration value to a batch, replacing the parameter's value if it's already there. */
+static inline void waveform_batch_add(waveform_batch_t *batch, waveform_cfg_t cfg)
+{
+	batch->mask |= 1 << cfg.type;
+	batch->values[cfg.type] = cfg.value;
+}
+
+/** Returns non-zero if a batch has a value for the parameter, and reads it into value. */
+static inline uint8_t waveform_batch_get(waveform_batch_t const *batch, waveform_cfg_param_t type,
+	uint32_t *value)
+{
+	if ((batch->mask & (1 << type)) == 0) {
+		return 0;
+	}
+	*value = batch->values[type];
+	return 1;
+}